@@ -0,0 +1,318 @@
+/* bench.c
+ * Benchmarks for the engine, run with `cactus bench [depth]`
+ *  -> Nodes and time to depth on the bench positions
+ *  -> Lazy SMP time-to-depth and NPS scaling
+ *  -> TP Table stress test (many threads hammering the same entries)
+ *  -> Make/unmake throughput and perft NPS
+ *  -> Slider attack lookup latency with magic and PEXT indexing
+ *  -> Full selection sort against picking the best move lazily, on move lists from a real search
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "bitboards.h"
+#include "bitboard_utils.h"
+#include "moves.h"
+#include "move_utils.h"
+#include "make_move.h"
+#include "generate_moves.h"
+#include "rook_moves.h"
+#include "bishop_moves.h"
+#include "init_magics.h"
+#include "legal_moves.h"
+#include "move_ordering.h"
+#include "perft_test.h"
+#include "search.h"
+#include "tp_table.h"
+#include "pawn_hash.h"
+#include "eval_cache.h"
+#include "bench.h"
+
+// Benchmark positions (FEN)
+char *bench_positions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", /* Starting position */
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", /* Kiwipete */
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", /* Rook endgame */
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", /* Tactical middlegame */
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 1", /* Quiet middlegame */
+};
+int bench_position_count = sizeof(bench_positions) / sizeof(char*);
+
+double bench_clock() {
+    /* Wall clock time in seconds */
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void bench_search(int depth) {
+    /* Measure nodes and time to depth with a single thread */
+    int saved_threads = search_threads; /* Put this back when done */
+    long long total_nodes = 0; /* Nodes over all positions */
+    long long total_cutoffs = 0, total_first = 0; /* Beta cutoffs, and the ones caused by the first move */
+    long long total_probes = 0, total_hits = 0; /* TP Table lookups, and the ones that found the position */
+    long long total_pawn_probes = 0, total_pawn_hits = 0; /* Same for the pawn hash table */
+    long long total_eval_probes = 0, total_eval_hits = 0; /* And the evaluation cache */
+    double total_time = 0; /* Time over all positions */
+    search_threads = 1;
+    printf("Search (depth %d)\n", depth);
+    printf("Position   Nodes          Time(s)    NPS          1st-move cutoff %%  TT hit %%  Hashfull  Pawn hit %%  Eval hit %%  Eval\n");
+    for (int p = 0; p < bench_position_count; p++) { /* Loop through the positions */
+        Bitboard board = {0,0,0,0};
+        parse_fen(&board, bench_positions[p]);
+        clear_tp_table(); /* Start every position with an empty table */
+        double start = bench_clock();
+        id_result_t result = iterative_deepening(&board, 0, depth); /* Search to the depth without a time limit */
+        double time_taken = bench_clock() - start;
+        total_time += time_taken;
+        total_nodes += result.nodes;
+        total_cutoffs += beta_cutoffs; total_first += first_move_cutoffs;
+        total_probes += tp_probes; total_hits += tp_hits;
+        total_pawn_probes += pawn_probes; total_pawn_hits += pawn_hits;
+        total_eval_probes += eval_probes; total_eval_hits += eval_hits;
+        printf("%-10d %-14lld %-10.3f %-12.0f %-19.1f %-9.1f %-9d %-11.1f %-11.1f %d\n", p + 1, result.nodes, time_taken, result.nodes / time_taken, 100.0 * first_move_cutoffs / (beta_cutoffs ? beta_cutoffs : 1), 100.0 * tp_hits / (tp_probes ? tp_probes : 1), tp_hashfull(), 100.0 * pawn_hits / (pawn_probes ? pawn_probes : 1), 100.0 * eval_hits / (eval_probes ? eval_probes : 1), result.evaluation);
+    }
+    printf("Total      %-14lld %-10.3f %-12.0f %-19.1f %-19.1f %-11.1f %.1f\n\n", total_nodes, total_time, total_nodes / total_time, 100.0 * total_first / (total_cutoffs ? total_cutoffs : 1), 100.0 * total_hits / (total_probes ? total_probes : 1), 100.0 * total_pawn_hits / (total_pawn_probes ? total_pawn_probes : 1), 100.0 * total_eval_hits / (total_eval_probes ? total_eval_probes : 1));
+    search_threads = saved_threads;
+}
+
+void bench_smp(int depth) {
+    /* Measure time-to-depth and NPS for 1, 2, 4, 8 and 16 lazy SMP threads */
+    int thread_counts[5] = {1, 2, 4, 8, 16};
+    int saved_threads = search_threads; /* Put this back when done */
+    double base_time = 0; /* Time-to-depth with one thread */
+    double base_nps = 0; /* NPS with one thread */
+    printf("Lazy SMP scaling (depth %d, %d positions)\n", depth, bench_position_count);
+    printf("Threads    Time(s)    Nodes          NPS          TTD Speedup  NPS Speedup\n");
+    for (int t = 0; t < 5; t++) { /* Loop through the thread counts */
+        search_threads = thread_counts[t];
+        long long nodes = 0; /* Total nodes over all positions */
+        double total_time = 0; /* Total time-to-depth over all positions */
+        for (int p = 0; p < bench_position_count; p++) { /* Loop through the positions */
+            Bitboard board = {0,0,0,0};
+            parse_fen(&board, bench_positions[p]);
+            clear_tp_table(); /* Start every position with an empty table */
+            double start = bench_clock();
+            id_result_t result = iterative_deepening(&board, 0, depth); /* Search to the depth without a time limit */
+            total_time += bench_clock() - start;
+            nodes += result.nodes;
+        }
+        double nps = nodes / total_time;
+        if (t == 0) { base_time = total_time; base_nps = nps; } /* The baseline */
+        printf("%-10d %-10.3f %-14lld %-12.0f %-12.2f %.2f\n", search_threads, total_time, nodes, nps, base_time / total_time, nps / base_nps);
+    }
+    search_threads = saved_threads;
+    printf("\n");
+}
+
+#define STRESS_KEYS 16 /* Few enough keys that the threads keep writing over each other's entries */
+#define STRESS_OPERATIONS 2000000 /* Stores (each followed by a probe) per thread */
+
+typedef struct stress_data_t {
+    /* Data for a TP Table stress test thread */
+    int id;
+    long long hits; /* Probes that found an entry */
+    long long torn; /* Entries found with data that was never stored together */
+} stress_data_t;
+
+U64 stress_keys[STRESS_KEYS]; /* Keys shared by all the stress test threads */
+
+move_t stress_move(U64 key, int eval, int depth) {
+    /* The move stored with an entry is made from the rest of the entry, so that a mix of two stores can be spotted */
+    return ((move_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) ^ (move_t)(eval * 2654435761U) ^ (move_t)(depth << 24)) | 1; /* Never 0 (no move) */
+}
+
+void *stress_thread(void *data_pointer) {
+    /* Store random entries for the shared keys and probe them straight back */
+    stress_data_t *data = (stress_data_t*)data_pointer;
+    U64 random = 0x2545F4914F6CDD1DULL * (data->id + 1); /* xorshift state */
+    for (int operation = 0; operation < STRESS_OPERATIONS; operation++) {
+        random ^= random << 13; random ^= random >> 7; random ^= random << 17; /* Next random number */
+        U64 key = stress_keys[random % STRESS_KEYS];
+        int eval = (int)((random >> 8) & 0x3fff) - 0x2000; /* Any score */
+        int depth = 1 + (int)((random >> 24) % 60);
+        add_entry(key, eval, depth, stress_move(key, eval, depth), node_pv); /* Exact entries always overwrite */
+        entry_t entry = get_entry(stress_keys[(random >> 32) % STRESS_KEYS]); /* Probe any of the keys */
+        if (invalid_entry(entry)) continue;
+        data->hits++;
+        if (entry.best_move != stress_move(entry.key, entry.eval, entry.depth) || entry.node_type != node_pv) data->torn++; /* Parts of different stores */
+    }
+    return 0;
+}
+
+void bench_tp_stress(int threads) {
+    /* Hammer a few TP Table entries from many threads at once, and check that no torn entry is ever returned */
+    pthread_t stress_threads[MAX_THREADS];
+    stress_data_t data[MAX_THREADS];
+    long long hits = 0, torn = 0;
+    U64 random = 0x9E3779B97F4A7C15ULL;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    for (int index = 0; index < STRESS_KEYS; index++) { /* Make up some keys */
+        random ^= random << 13; random ^= random >> 7; random ^= random << 17;
+        stress_keys[index] = random;
+    }
+    printf("TP Table stress test (%d threads, %d stores and probes each)\n", threads, STRESS_OPERATIONS);
+    double start = bench_clock();
+    for (int index = 0; index < threads; index++) { /* Launch the threads */
+        data[index] = (stress_data_t){index, 0, 0};
+        pthread_create(&stress_threads[index], NULL, stress_thread, &data[index]);
+    }
+    for (int index = 0; index < threads; index++) { /* Wait for them */
+        pthread_join(stress_threads[index], NULL);
+        hits += data[index].hits;
+        torn += data[index].torn;
+    }
+    printf("Time %.3fs, hits %lld, torn entries %lld (%s)\n\n", bench_clock() - start, hits, torn, torn ? "FAILED" : "ok");
+    clear_tp_table(); /* Don't leave the junk entries behind */
+}
+
+#define MAKE_UNMAKE_ROUNDS 200000 /* Times every move of a bench position is made and unmade */
+#define PERFT_DEPTH 4
+
+void bench_make_move() {
+    /* Measure make/unmake throughput, and perft NPS with the legal and pseudo-legal move generators (cross checking their counts) */
+    long long pairs = 0, perft_nodes = 0, pseudo_legal_nodes = 0;
+    double make_time = 0, perft_time = 0, pseudo_legal_time = 0;
+    for (int p = 0; p < bench_position_count; p++) { /* Loop through the positions */
+        Bitboard board = {0,0,0,0};
+        parse_fen(&board, bench_positions[p]);
+        move_list_t moves = {0,0};
+        generate_moves(&board, &moves); /* Pseudo-legal moves are fine, legality doesn't matter for make/unmake */
+        double start = bench_clock();
+        for (int round = 0; round < MAKE_UNMAKE_ROUNDS; round++) {
+            for (int index = 0; index < moves.count; index++) {
+                make_move(&board, moves.moves[index]);
+                unmake_move(&board, moves.moves[index]);
+            }
+        }
+        make_time += bench_clock() - start;
+        pairs += (long long)MAKE_UNMAKE_ROUNDS * moves.count;
+        start = bench_clock();
+        perft_nodes += count_moves(&board, PERFT_DEPTH);
+        perft_time += bench_clock() - start;
+        start = bench_clock();
+        pseudo_legal_nodes += count_moves_pseudo_legal(&board, PERFT_DEPTH);
+        pseudo_legal_time += bench_clock() - start;
+    }
+    printf("Make/unmake: %lld pairs in %.3fs (%.1fM per second)\n", pairs, make_time, pairs / make_time / 1e6);
+    printf("Perft (depth %d): %lld nodes in %.3fs (%.0f NPS)\n", PERFT_DEPTH, perft_nodes, perft_time, perft_nodes / perft_time);
+    printf("Pseudo-legal perft (depth %d): %lld nodes in %.3fs (%.0f NPS) %s\n\n", PERFT_DEPTH, pseudo_legal_nodes, pseudo_legal_time, pseudo_legal_nodes / pseudo_legal_time, pseudo_legal_nodes == perft_nodes ? "(ok)" : "(MISMATCH)");
+}
+
+#define SLIDER_LOOKUPS 20000000 /* Lookups per piece and backend */
+
+double bench_slider_lookups(U64 (*lookup)(int, U64, U64)) {
+    /* Nanoseconds per lookup, each one depending on the last so this is latency rather than throughput */
+    U64 random = 0x9E3779B97F4A7C15ULL, occupied, attacks = 0; /* Xorshift state for the blockers */
+    int square = 0;
+    double start = bench_clock();
+    for (int i = 0; i < SLIDER_LOOKUPS; i++) {
+        random ^= random << 13; random ^= random >> 7; random ^= random << 17;
+        occupied = (random & (random >> 11)) ^ attacks; /* About a quarter of the board, mixed with the previous result */
+        attacks = lookup(square, 0, occupied);
+        square = (square + 1 + (attacks & 7)) & 63; /* Next square depends on the result too */
+    }
+    double elapsed = bench_clock() - start;
+    if (attacks == 1) printf(" "); /* Keep the loop from being optimized away */
+    return elapsed / SLIDER_LOOKUPS * 1e9;
+}
+
+void bench_sliders() {
+    /* Compare magic_rook_moves/magic_bishop_moves latency between the slider table backends */
+    int saved_backend = slider_backend;
+    printf("Slider attack table: %d entries (%.0f KB)\n", SLIDER_TABLE_SIZE, SLIDER_TABLE_SIZE * sizeof(U64) / 1024.0);
+    for (int backend = SLIDER_MAGIC; backend <= SLIDER_PEXT; backend++) {
+        if (backend == SLIDER_PEXT && !pext_supported()) {
+            printf("PEXT: not supported on this CPU\n");
+            continue;
+        }
+        set_slider_backend(backend);
+        double rook = bench_slider_lookups(magic_rook_moves);
+        double bishop = bench_slider_lookups(magic_bishop_moves);
+        printf("%-6s rook %.2f ns, bishop %.2f ns per lookup\n", backend == SLIDER_PEXT ? "PEXT:" : "Magic:", rook, bishop);
+    }
+    set_slider_backend(saved_backend); /* Back to whatever was picked at startup */
+    printf("\n");
+}
+
+#define TRACE_MOVES (1 << 22) /* Scored moves recorded from the search */
+#define TRACE_LISTS (1 << 20) /* Scored lists recorded from the search */
+#define REPLAY_ROUNDS 5 /* Times the recorded lists are ordered by each method */
+
+void bench_move_ordering(int depth) {
+    /* Record the scored move lists of a real search, and how many moves the search picked from each before cutting off (or running out).
+     * Then replay them: sort each list fully like order_moves, or pick the best move lazily like the search does, taking as many moves as the search did.
+    */
+    int saved_threads = search_threads; /* Put this back when done */
+    move_trace_t trace = {malloc(TRACE_MOVES * sizeof(scored_move_t)), 0, TRACE_MOVES, malloc(TRACE_LISTS * sizeof(traced_list_t)), 0, TRACE_LISTS};
+    if (!trace.moves || !trace.lists) {
+        printf("Move ordering: not enough memory for the trace\n\n");
+        free(trace.moves); free(trace.lists);
+        return;
+    }
+    search_threads = 1; /* The trace isn't thread safe */
+    move_trace = &trace;
+    for (int p = 0; p < bench_position_count; p++) { /* Search the positions, recording as we go */
+        Bitboard board = {0,0,0,0};
+        parse_fen(&board, bench_positions[p]);
+        clear_tp_table();
+        iterative_deepening(&board, 0, depth);
+    }
+    move_trace = 0;
+    search_threads = saved_threads;
+    clear_tp_table();
+
+    long long picked = 0; /* Moves picked from the lists */
+    long long sort_check = 0, pick_check = 0; /* The scores of the picked moves, weighted by their position, should be the same both ways */
+    move_list_t moves; /* For the full sort */
+    int scores[256];
+    scored_list_t list; /* For the lazy picks */
+    list.trace = -1;
+    double start = bench_clock();
+    for (int round = 0; round < REPLAY_ROUNDS; round++) {
+        for (int index = 0; index < trace.list_count; index++) { /* Full selection sort */
+            traced_list_t *traced = &trace.lists[index];
+            for (int move = 0; move < traced->count; move++) {
+                moves.moves[move] = trace.moves[traced->start + move].move;
+                scores[move] = trace.moves[traced->start + move].score;
+            }
+            moves.count = traced->count;
+            sort_moves(&moves, scores);
+            for (int move = 0; move < traced->picked; move++) sort_check += (long long)scores[move] * (move + 1);
+        }
+    }
+    double sort_time = bench_clock() - start;
+    start = bench_clock();
+    for (int round = 0; round < REPLAY_ROUNDS; round++) {
+        for (int index = 0; index < trace.list_count; index++) { /* Lazy best-first picks */
+            traced_list_t *traced = &trace.lists[index];
+            memcpy(list.moves, trace.moves + traced->start, traced->count * sizeof(scored_move_t));
+            list.count = traced->count;
+            list.next = 0;
+            for (int move = 0; move < traced->picked; move++) {
+                pick_next_best(&list);
+                pick_check += (long long)list.moves[move].score * (move + 1);
+            }
+            picked += traced->picked;
+        }
+    }
+    double pick_time = bench_clock() - start;
+    long long orderings = (long long)REPLAY_ROUNDS * trace.list_count;
+    printf("Move ordering (depth %d): %d lists, %.1f moves per list, %.1f picked\n", depth, trace.list_count, (double)trace.move_count / (trace.list_count ? trace.list_count : 1), (double)picked / (orderings ? orderings : 1));
+    printf("Selection sort: %.1f ns per list\n", sort_time / (orderings ? orderings : 1) * 1e9);
+    printf("Pick next best: %.1f ns per list %s\n\n", pick_time / (orderings ? orderings : 1) * 1e9, sort_check == pick_check ? "(ok)" : "(MISMATCH)");
+    free(trace.moves);
+    free(trace.lists);
+}
+
+void run_bench(int depth) {
+    /* Run all the benchmarks */
+    bench_search(depth);
+    bench_smp(depth);
+    bench_tp_stress(16);
+    bench_make_move();
+    bench_sliders();
+    bench_move_ordering(depth);
+}
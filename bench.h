@@ -0,0 +1,15 @@
+/* Header file for bench.c */
+#ifndef BENCH_H
+#define BENCH_H
+#define BENCH_DEPTH 6 /* Default depth for the benchmarks */
+extern char *bench_positions[];
+extern int bench_position_count;
+double bench_clock();
+void bench_search(int depth);
+void bench_smp(int depth);
+void bench_tp_stress(int threads);
+void bench_make_move();
+void bench_sliders();
+void bench_move_ordering(int depth);
+void run_bench(int depth);
+#endif
@@ -11,22 +11,27 @@
 #include "lookup_tables.h"
 #include "init_magics.h"
 
-U64 magic_bishop_moves(int square, U64 own, U64 enemy) {
+U64 magic_bishop_lookup(int square, U64 own, U64 enemy) {
     /* Get the bishop move set from magic attack table */
-    U64 occupancies = (own | enemy) & bishop_masks[square]; /* Get occupancy bits */
-    int index = (occupancies * bishop_magics[square]) >> bishop_shifts[square]; /* Index of the magic attacks on the board */
-    U64 attacks = bishop_attacks[square][index]; /* Lookup the attacks from the pre-initialized table */
+    const magic_t *entry = &bishop_table[square]; /* Mask, magic and table slice for the square */
+    U64 attacks = entry->attacks[magic_index(entry, own | enemy)]; /* Lookup the attacks from the pre-initialized table */
     attacks &= ~own; /* Remove squares blocked by own pieces from the move set */
     return attacks;
 }
-void add_bishop_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int from, U64 enemy_mask); /* Forward decleration */
 
-void generate_bishop_moves(move_list_t *move_list, Bitboard *board) {
+U64 pext_bishop_lookup(int square, U64 own, U64 enemy) {
+    /* Same, for tables indexed with PEXT */
+    const magic_t *entry = &bishop_table[square];
+    return entry->attacks[pext_index(entry, own | enemy)] & ~own;
+}
+U64 (*magic_bishop_moves)(int square, U64 own, U64 enemy) = magic_bishop_lookup; /* Picked once by set_slider_backend, so lookups don't test the backend */
+SIDE_INLINE void add_bishop_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int from, U64 enemy_mask, const int side); /* Forward decleration */
+
+SIDE_INLINE void generate_bishop_moves_side(move_list_t *move_list, Bitboard *board, int gen_type, const int side) {
     /* Generates all possible moves by moving bishops, and adds them to the move list */
     // Masks
-    int side = board->side; /* Side to move */
-    U64 own_mask = colour_mask(board, side); /* Piece mask of own side */
-    U64 enemy_mask = colour_mask(board, !side); /* Piece mask of enemy pieces */
+    U64 own_mask = board->occupancy[side]; /* Piece mask of own side */
+    U64 enemy_mask = board->occupancy[!side]; /* Piece mask of enemy pieces */
     // Declare for loop
     U64 bishops = (side) ? board->pieces[bishop_w] : board->pieces[bishop_b]; /* Bishops bitboard */
     U64 position = 0; /* Bishop position (current bit) */
@@ -37,13 +42,13 @@ void generate_bishop_moves(move_list_t *move_list, Bitboard *board) {
         position = bishops & -bishops; /* Get next bishop (Isolate LSB) */
         bishop_index = bitscan(position); /* Get index of bishop */
         move_set = magic_bishop_moves(bishop_index, own_mask, enemy_mask); /* Get the move set */
-        add_bishop_moves(move_set, board, move_list, bishop_index, enemy_mask); /* Add the moves from this move set to the move list */
+        move_set &= target_mask(own_mask, enemy_mask, gen_type); /* Remove the squares we don't want */
+        add_bishop_moves(move_set, board, move_list, bishop_index, enemy_mask, side); /* Add the moves from this move set to the move list */
         bishops ^= position; /* Reset LSB */
     }
 }
-void add_bishop_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int from, U64 enemy_mask) {
+SIDE_INLINE void add_bishop_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int from, U64 enemy_mask, const int side) {
     /* Adds all the bishop moves from a move set to the move list */
-    int side = board->side; /* Makes code writing easier */
     // Declare for loop
     U64 position;
     U64 cap_flag; /* Check if move is a capture */
@@ -54,7 +59,7 @@ void add_bishop_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int
         position = move_set & -move_set; /* Isolate LSB */
         pos_index = bitscan(position); /* Get the index of the move */
         cap_flag = position & enemy_mask; /* Check if this is a capture move */
-        if (cap_flag) cap_piece = get_captured_piece(board, position, side); /* Get captured piece id (if there is one) */
+        if (cap_flag) cap_piece = board->mailbox[pos_index]; /* Get captured piece id (if there is one) */
         move = set_move(from, pos_index /* to */, (side) ? bishop_w : bishop_b /* Piece */, (cap_flag) ? cap_piece : 0 /* Captured piece id */);
         // Set flags
         if (cap_flag) move |= MM_CAP; /* If this is a capture move, set the capture flag */
@@ -63,3 +68,5 @@ void add_bishop_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int
         move_set ^= position; /* Remove move from set (Reset LSB) */
     }
 }
+
+SIDE_SPECIALIZED_GENERATOR(generate_bishop_moves)
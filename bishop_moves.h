@@ -1,7 +1,11 @@
 /* header file for bishop_moves.c */
 #ifndef MOVEGEN_BISHOPMOVES_H
 #define MOVEGEN_BISHOPMOVES_H
-void generate_bishop_moves(move_list_t *move_list, Bitboard *board);
-U64 magic_bishop_moves(int square, U64 own, U64 enemy);
+void generate_bishop_moves(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_bishop_moves_w(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_bishop_moves_b(move_list_t *move_list, Bitboard *board, int gen_type);
+U64 magic_bishop_lookup(int square, U64 own, U64 enemy);
+U64 pext_bishop_lookup(int square, U64 own, U64 enemy);
+extern U64 (*magic_bishop_moves)(int square, U64 own, U64 enemy);
 
 #endif
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include "bitboards.h"
 #include "legality_test.h"
+#include "move_gen_utils.h"
 #include "lookup_tables.h"
 #include "zobrist_hash.h"
 
@@ -17,11 +18,15 @@ void clear_board(Bitboard *board) {
         board->pieces[i] = 0; /* Empty them */
         board->attack_tables[i] = 0; /* Empty their attack tables as well */
     }
+    board->occupancy[0] = board->occupancy[1] = board->occupied = 0;
+    for (int square = 0; square < 64; square++) board->mailbox[square] = NO_PIECE; /* Empty the mailbox */
     // Empty everything else
     board->castling_rights = 0;
     board->enpas = 0;
     board->side = 0;
     board->key = 0;
+    board->pawn_key = 0;
+    board->stale_sliders = 0;
     board->moves = 0;
 }
 
@@ -38,9 +43,11 @@ void init_board(Bitboard *board, char init_state[64], int side_to_move) {
             for (int p = 0; p < 12; p++) { /* loop through piece types */
                 if (letters[p] == piece_type) {
                     board->pieces[p] |= position; /* Add piece to bb */
+                    board->mailbox[((7 - y) * 8) + x] = p; /* And to the mailbox */
                     board->piece_square_eval += piece_square[p][((7 - y) * 8) + x];
                     // Update hash key
                     board->key ^= pst_hash[p][((7 - y) * 8) + x]; /* Xor the piece on square to the zobrist hash */
+                    if (p == pawn_w || p == pawn_b) board->pawn_key ^= pst_hash[p][((7 - y) * 8) + x]; /* And to the pawn hash */
                 }
             }
         }
@@ -48,6 +55,9 @@ void init_board(Bitboard *board, char init_state[64], int side_to_move) {
     // Set everything else
     board->castling_rights = W_CASTLE | B_CASTLE; /* Enable castling on both sides */
     board->side = side_to_move != 0;
+    board->occupancy[0] = colour_mask(board, 0); /* Occupancy bitboards (make/unmake keep them up to date from now on) */
+    board->occupancy[1] = colour_mask(board, 1);
+    board->occupied = board->occupancy[0] | board->occupancy[1];
     for (int piece = 0; piece < 12; piece++) { /* Loop through all piece types */
         update_attack_table(board, piece);
     }
@@ -55,7 +65,7 @@ void init_board(Bitboard *board, char init_state[64], int side_to_move) {
     board->key ^= cr_hash[0];
     board->key ^= cr_hash[1];
     board->key ^= cr_hash[2];
-    board->key ^= cr_hash[4];
+    board->key ^= cr_hash[3];
 
     if (side_to_move == 0) board->key != side_hash;
 }
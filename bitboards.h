@@ -4,18 +4,38 @@
 
 typedef uint64_t U64; /* Type for all 64 bit unsigned integers */
 
+#define UNDO_STACK_SIZE 256 /* Plies that can be unmade (a power of 2, more than the deepest search line) */
+
+// Board state that make_move can't reverse by itself
+typedef struct undo_t {
+    U64 castling_rights;
+    U64 enpas;
+    U64 key;
+    U64 pawn_key;
+    int piece_square_eval;
+    U64 attack_tables[12]; /* Restored by copying instead of being regenerated */
+    int stale_sliders;
+    U64 occupancy[2];
+    U64 occupied;
+} undo_t;
+
 // Define structure for bitboards
 typedef struct Bitboard {
     U64 pieces[12]; /* All piece bitboards */
+    U64 occupancy[2]; /* All the pieces of each side (0 = black, 1 = white), kept in sync by make/unmake */
+    U64 occupied; /* All the pieces on the board */
+    unsigned char mailbox[64]; /* Piece id on every square (NO_PIECE if it is empty), kept in sync by make/unmake */
     // Other board details
     U64 castling_rights; /* 1st 4 bits are relevant */
     U64 enpas; /* Figure this out later (probably a file mask) */
     U64 attack_tables[12]; /* Attack tables of all the pieces on the board */
+    int stale_sliders; /* The sliding piece attack tables are out of date (they are only updated when needed, see attack_table) */
     int side; /* Side to move */
     
     int piece_square_eval; /* Evaluation term for piece-square-tables */
     U64 key; /* Zobrist hash for bitboard */
-    int moves;
+    U64 pawn_key; /* Zobrist hash of the pawns only (for the pawn hash table) */
+    int moves; /* Also indexes the undo records (see undo_record in make_move.c) */
 } Bitboard;
 
 // Other important details
@@ -24,6 +44,8 @@ enum { /* Piece ids */
     rook_b = 6, knight_b = 7, bishop_b = 8, queen_b = 9, king_b = 10, pawn_b = 11
 };
 
+#define NO_PIECE 12 /* Empty square in the mailbox */
+
 // Castling right masks.
 #define WK_CASTLE 1 /* & it with the castling rights to get the value */
 #define WQ_CASTLE 2
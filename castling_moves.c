@@ -19,11 +19,11 @@
 #define B_QUEENSIDE 0x0E00000000000000
 
 
-void generate_castling_moves(move_list_t *move_list, Bitboard *board) {
+SIDE_INLINE void generate_castling_moves_side(move_list_t *move_list, Bitboard *board, int gen_type, const int side) {
     /* Generate all possible castling moves from a position */
-    int side = board->side; /* Convenience */
-    U64 own_mask = colour_mask(board, side); /* Get own team mask */
-    U64 enemy_mask = colour_mask(board, !side); /* Get enemy mask */
+    if (gen_type == gen_captures) return; /* Castling is a quiet move */
+    U64 own_mask = board->occupancy[side]; /* Get own team mask */
+    U64 enemy_mask = board->occupancy[!side]; /* Get enemy mask */
     U64 all_mask = own_mask | enemy_mask; /* Mask of both sides */
     // King's-side castling
     if (
@@ -46,3 +46,5 @@ void generate_castling_moves(move_list_t *move_list, Bitboard *board) {
         add_move_to_list(move_list, move);
     }
 } 
+
+SIDE_SPECIALIZED_GENERATOR(generate_castling_moves)
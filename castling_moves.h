@@ -1,5 +1,7 @@
 /* header file for castling_moves.c */
 #ifndef MOVEGEN_CASTLING_H
 #define MOVEGEN_CASTLING_H
-void generate_castling_moves(move_list_t *move_list, Bitboard *board);
+void generate_castling_moves(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_castling_moves_w(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_castling_moves_b(move_list_t *move_list, Bitboard *board, int gen_type);
 #endif
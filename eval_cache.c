@@ -0,0 +1,32 @@
+/* eval_cache.c
+ * Static evaluations, cached by zobrist key.
+ * Every entry is a single 64 bit word holding the upper 48 bits of the key and a 16 bit evaluation,
+ * so the search threads can share the cache without locks and can never read half of an entry.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "bitboards.h"
+#include "evaluation.h"
+#include "eval_cache.h"
+
+#define EVAL_MASK 0xffffULL /* The evaluation part of an entry, the rest is the key check */
+
+static _Atomic U64 eval_cache[EVAL_CACHE_SIZE]; /* Shared by all the search threads */
+__thread long long eval_probes = 0; /* Evaluation cache lookups by the current thread */
+__thread long long eval_hits = 0; /* Lookups that found the position */
+
+int cached_evaluate(Bitboard *board) {
+    /* Statically evaluate the board, using the cached evaluation if there is one */
+    U64 key = board->key ^ ((U64)opening_weight(board) * 0x9e3779b97f4a7c15ULL); /* The evaluation tapers with the move count, which the zobrist key leaves out */
+    _Atomic U64 *slot = &eval_cache[key & (EVAL_CACHE_SIZE - 1)]; /* The low bits pick the slot */
+    U64 entry = atomic_load_explicit(slot, memory_order_relaxed);
+    eval_probes++;
+    if ((entry & ~EVAL_MASK) == (key & ~EVAL_MASK)) { /* The upper bits match */
+        eval_hits++;
+        return (short)(entry & EVAL_MASK); /* Sign extend the evaluation */
+    }
+    int evaluation = evaluate(board);
+    atomic_store_explicit(slot, (key & ~EVAL_MASK) | ((U64)evaluation & EVAL_MASK), memory_order_relaxed);
+    return evaluation;
+}
@@ -0,0 +1,9 @@
+/* Header file for eval_cache.c */
+#ifndef EVALCACHE_H
+#define EVALCACHE_H
+#define EVAL_CACHE_SIZE 65536 /* Entries in the shared evaluation cache (a power of 2, at most 65536) */
+
+int cached_evaluate(Bitboard *board);
+extern __thread long long eval_probes;
+extern __thread long long eval_hits;
+#endif
@@ -13,6 +13,7 @@
 #include "make_move.h"
 #include "legality_test.h"
 #include "generate_moves.h"
+#include "pawn_hash.h"
 
 #define OPENING_END 25
 #define KING_CORNER_WEIGHT 10
@@ -70,5 +71,9 @@ int evaluate(Bitboard *board) {
     else pst_eval = (pst_eval * opening_weight(board)) / OPENING_END;
     evaluation += pst_eval;
 
+    // Add pawn structure evaluation
+    pawn_entry_t *pawns = probe_pawn_table(board); /* Almost always in the pawn hash table already */
+    evaluation += side ? pawns->score : -pawns->score;
+
     return evaluation;
 }
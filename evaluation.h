@@ -3,4 +3,5 @@
 #define EVALUATION_H
 int evaluate(Bitboard *board);
 int count_material(Bitboard *board, int side);
+int opening_weight(Bitboard *board);
 #endif
@@ -16,13 +16,38 @@
 #include "castling_moves.h"
 #include "move_gen_utils.h"
 
+void generate_moves_type(Bitboard *board, move_list_t *moves, int gen_type) {
+    /* Generate pseudo-legal moves of a certain type (see moves.h), with the generators specialized for the side to move */
+    if (board->side) {
+        generate_pawn_moves_w(moves, board, gen_type);
+        generate_knight_moves_w(moves, board, gen_type);
+        generate_king_moves_w(moves, board, gen_type);
+        generate_rook_moves_w(moves, board, gen_type);
+        generate_bishop_moves_w(moves, board, gen_type);
+        generate_queen_moves_w(moves, board, gen_type);
+        generate_castling_moves_w(moves, board, gen_type);
+    } else {
+        generate_pawn_moves_b(moves, board, gen_type);
+        generate_knight_moves_b(moves, board, gen_type);
+        generate_king_moves_b(moves, board, gen_type);
+        generate_rook_moves_b(moves, board, gen_type);
+        generate_bishop_moves_b(moves, board, gen_type);
+        generate_queen_moves_b(moves, board, gen_type);
+        generate_castling_moves_b(moves, board, gen_type);
+    }
+}
+
 void generate_moves(Bitboard *board, move_list_t *moves) {
     /* Generate all pseudo-legal moves */
-        generate_pawn_moves(moves, board);
-        generate_knight_moves(moves, board);
-        generate_king_moves(moves, board);
-        generate_rook_moves(moves, board);
-        generate_bishop_moves(moves, board);
-        generate_queen_moves(moves, board);
-        generate_castling_moves(moves, board);
+    generate_moves_type(board, moves, gen_all);
+}
+
+void generate_captures(Bitboard *board, move_list_t *moves) {
+    /* Generate pseudo-legal captures and promotions */
+    generate_moves_type(board, moves, gen_captures);
+}
+
+void generate_quiets(Bitboard *board, move_list_t *moves) {
+    /* Generate pseudo-legal quiet moves */
+    generate_moves_type(board, moves, gen_quiets);
 }
@@ -1,5 +1,8 @@
 /* header file for generate_moves.c */
 #ifndef MOVEGEN_GENMOVES_H
 #define MOVEGEN_GENMOVES_H
+void generate_moves_type(Bitboard *board, move_list_t *moves, int gen_type);
 void generate_moves(Bitboard *board, move_list_t *moves);
+void generate_captures(Bitboard *board, move_list_t *moves);
+void generate_quiets(Bitboard *board, move_list_t *moves);
 #endif
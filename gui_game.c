@@ -19,6 +19,7 @@
 #include "lookup_tables.h"
 #include "legality_test.h"
 #include "generate_moves.h"
+#include "legal_moves.h"
 #include "perft_test.h"
 #include "search.h"
 #include "evaluation.h"
@@ -35,20 +36,6 @@
 
 char *piece_icons[12] = {"♜", "♞", "♝", "♛", "♚", "♟", "♜", "♞", "♝", "♛", "♚", "♟"}; /* Chess piece icons */
 
-move_list_t generate_legal_moves(Bitboard *board) {
-    /* Returns a list of legal moves */
-    move_list_t pseudo_legal = {0,0}; /* Pseudo legal moves */
-    move_list_t legal = {0,0}; /* Legal moves */
-    generate_moves(board, &pseudo_legal); /* generate pseudo-legal moves */
-    // Filter out illegal moves
-    for (int i = 0; i < pseudo_legal.count; i++) { /* Loop through all legal moves */
-        if (is_legal(board, pseudo_legal.moves[i])) { /* If the move is legal */
-            add_move_to_list(&legal, pseudo_legal.moves[i]); /* Add it to the legal moves list */
-        }
-    }
-    return legal;
-}
-
 void update_game_state(GameState *state, int evaluation, move_t last_move, int depth, int update_text) { 
     /* Update the game state based on the board */
     state->evaluation = evaluation;
@@ -65,14 +52,8 @@ void update_game_state(GameState *state, int evaluation, move_t last_move, int d
     
     // Update mailbox notation
     for (int square = 0; square < 64; square++) { /* Loop through all the squares */
-        U64 position = 1ULL << square; /* Get position */
-        int piece = -1;
-        for (int bb = 0; bb < 12; bb++) { /* Loop through all bitboards */
-            if (state->board->pieces[bb] & position) { /* If there is a piece on that position */
-                piece = bb; /* Set the piece id */
-            }
-        }
-        state->mailbox[square] = piece;
+        int piece = state->board->mailbox[square]; /* The board keeps its own mailbox */
+        state->mailbox[square] = (piece == NO_PIECE) ? -1 : piece; /* -1 for empty squares */
     }
 
     // Update text
@@ -91,7 +72,8 @@ void update_game_state(GameState *state, int evaluation, move_t last_move, int d
         gtk_label_set_text(GTK_LABEL(state->move_text), move_val);
         gtk_label_set_text(GTK_LABEL(state->side_text), state->side ? "Side To Move - White" : "Side To Move - Black");
     }
-    state->legal_moves = generate_legal_moves(state->board); /* Generate legal moves for checking later */
+    state->legal_moves.count = 0;
+    generate_legal_moves(state->board, &state->legal_moves); /* Generate legal moves for checking later */
 }
 
 gboolean draw_board(GtkWidget *drawing_area, cairo_t *canvas, GameState *state) {
@@ -288,9 +270,8 @@ void update_move_log(GameState *state, int count, int side, U64 key, move_t move
 void play_move_on_board(GameState *state, move_t move, int eval, int depth) {
     /* Play a move on the board, and update status */
     if (!state->game_over) {
-        U64 a, b, c; int d; /* Saved data stuff for move */
         if (state->log_filename) update_move_log(state, state->board->moves + 1, state->side, state->board->key, move, depth, eval); /* Log the move */
-        make_move(state->board, move, &a, &b, &c, &d); /* Make the move on the board */
+        make_move(state->board, move); /* Make the move on the board */
         update_game_state(state, eval, move, depth, 1); /* Update the game state with the last move */
         // Check for checkmate
         if (!state->legal_moves.count) { /* Check if there are no legal moves left */
@@ -313,7 +294,7 @@ void *engine_think(void *state_pointer) {
     id_result_t result; /* Search result */
     GameState *state = (GameState*)state_pointer; /* Cast the state pointer into a gamestate */
     gtk_label_set_markup(GTK_LABEL(state->think_text), g_markup_printf_escaped("<span size=\"large\" style=\"italic\">%s</span>", "The Cactus is Thinking"));
-    result = iterative_deepening(state->board, state->think_time);
+    result = iterative_deepening(state->board, state->think_time * 1000, 0); /* Think time is in seconds */
     play_move_on_board(state, result.move, result.evaluation, result.depth); /* Play the move on the board, and update values */
     gtk_label_set_markup(GTK_LABEL(state->think_text), g_markup_printf_escaped("<span size=\"large\" style=\"italic\">%s</span>", ""));
     gtk_widget_queue_draw(state->drawing_area); /* Update drawing area */
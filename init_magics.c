@@ -2,11 +2,18 @@
  * Generation of magic bitboard tables.
 */
 #include <stdio.h>
+#include <stdlib.h>
 #include "lookup_tables.h"
 #include "bitboards.h"
 #include "bitboard_utils.h"
-U64 rook_attacks[64][4096]; /* Rook attack table */
-U64 bishop_attacks[64][4096]; /* Bishop attack table */
+#include "init_magics.h"
+#include "moves.h"
+#include "rook_moves.h"
+#include "bishop_moves.h"
+U64 slider_attacks[SLIDER_TABLE_SIZE]; /* Rook and bishop attacks for every square, packed back to back */
+magic_t rook_table[64]; /* Where each square's rook attacks are, and how to index them */
+magic_t bishop_table[64]; /* Same for bishops */
+int slider_backend = SLIDER_MAGIC; /* How the tables are indexed */
 
 // Slow rook move gen
 U64 rook_attack_loop(int square, U64 blockers) {
@@ -59,42 +66,68 @@ U64 bishop_attack_loop(int square, U64 blockers) {
 }
 // Initialize attack tables
 
-void init_rook_square_table(int square) {
-    /* Initialize the rook attack tables for a square */
-    U64 magic = rook_magics[square]; /* Get magic */
-    U64 mask = rook_masks[square]; /* Get mask */
-    int shift = rook_shifts[square]; /* I hope these repitative comments aren't getting annoying */
+int slider_table_size(U64 mask, int shift) {
+    /* Entries a square needs, enough for both magic and PEXT indices */
+    int magic_size = 1 << (64 - shift), pext_size = 1 << __builtin_popcountll(mask);
+    return magic_size > pext_size ? magic_size : pext_size;
+}
+
+void init_slider_square(magic_t *entry, int square, U64 (*attack_loop)(int, U64)) {
+    /* Fill in the attacks of one square, indexed with the current backend */
+    U64 mask = entry->mask; /* Get mask */
     U64 occupancies = 0; /* The blocker bitset */
-    int index; /* Magic index */
-    U64 attacks; /* Rook attacks */
     do { /* Loop through all subsets of the mask */
-        index = (occupancies * magic) >> shift; /* Calculate index */
-        attacks = rook_attack_loop(square, occupancies); /* Get the rook attacks */
-        rook_attacks[square][index] = attacks; /* Set the attacks in the correct index in the rook attack table */
+        int index = (slider_backend == SLIDER_PEXT) ? pext_index(entry, occupancies) : magic_index(entry, occupancies);
+        entry->attacks[index] = attack_loop(square, occupancies); /* Set the attacks in the correct index of the square's slice */
     } while (occupancies = (occupancies - mask) & mask); /* Somehow this actually works */
-    /* Finally...  */
+}
+
+void init_rook_square_table(int square) {
+    /* Initialize the rook attack tables for a square */
+    init_slider_square(&rook_table[square], square, rook_attack_loop);
 }
 
 void init_bishop_square_table(int square) {
     /* Initialize the bishop attack tables for a square */
-    U64 magic = bishop_magics[square]; /* Get magic */
-    U64 mask = bishop_masks[square]; /* Get mask */
-    int shift = bishop_shifts[square]; /* I hope these repitative comments aren't getting annoying */
-    U64 occupancies = 0; /* The blocker bitset */
-    int index; /* Magic index */
-    U64 attacks; /* Bishop attacks */
-    do { /* Loop through all subsets of the mask */
-        index = (occupancies * magic) >> shift; /* Calculate index */
-        attacks = bishop_attack_loop(square, occupancies); /* Get the bishop attacks */
-        bishop_attacks[square][index] = attacks; /* Set the attacks in the correct index in the bishop attack table */
-    } while (occupancies = (occupancies - mask) & mask); /* Somehow this actually works */
-    /* Finally...  */
+    init_slider_square(&bishop_table[square], square, bishop_attack_loop);
 }
 
-void init_magic_tables() {
-    /* Didn't you read the last line?? */
+int pext_supported() {
+    /* Check (CPUID) whether the CPU has BMI2 */
+#ifdef __x86_64__
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+#else
+    return 0;
+#endif
+}
+
+void set_slider_backend(int backend) {
+    /* Switch between magic and PEXT indexing, rebuild the tables to match and point the lookups at the right functions */
+    if (backend == SLIDER_PEXT && !pext_supported()) backend = SLIDER_MAGIC; /* Magics work everywhere */
+    slider_backend = backend;
+    magic_rook_moves = (backend == SLIDER_PEXT) ? pext_rook_lookup : magic_rook_lookup;
+    magic_bishop_moves = (backend == SLIDER_PEXT) ? pext_bishop_lookup : magic_bishop_lookup;
     for (int square = 0; square < 64; square++) {
-        init_rook_square_table(square);  
+        init_rook_square_table(square);
         init_bishop_square_table(square);
     }
-} 
+}
+
+void init_magic_tables() {
+    /* Lay out the squares in the shared table, then fill it in using PEXT if the CPU has it */
+    U64 *attacks = slider_attacks; /* Start of the next square's slice */
+    for (int square = 0; square < 64; square++) {
+        rook_table[square] = (magic_t){attacks, rook_masks[square], rook_magics[square], rook_shifts[square]};
+        attacks += slider_table_size(rook_masks[square], rook_shifts[square]);
+    }
+    for (int square = 0; square < 64; square++) {
+        bishop_table[square] = (magic_t){attacks, bishop_masks[square], bishop_magics[square], bishop_shifts[square]};
+        attacks += slider_table_size(bishop_masks[square], bishop_shifts[square]);
+    }
+    if (attacks - slider_attacks > SLIDER_TABLE_SIZE) { /* The magics/shifts don't match the table size */
+        printf("Slider attack table too small (%ld entries needed)\n", (long)(attacks - slider_attacks));
+        exit(1);
+    }
+    set_slider_backend(pext_supported() ? SLIDER_PEXT : SLIDER_MAGIC);
+}
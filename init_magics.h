@@ -1,10 +1,37 @@
 /* header file for init_magics.c */
 #ifndef INIT_MAGICS_H
 #define INIT_MAGICS_H
+#define SLIDER_TABLE_SIZE 107648 /* 102400 rook + 5248 bishop entries (~840 KB) */
+#define SLIDER_MAGIC 0 /* Index with magic multiplication */
+#define SLIDER_PEXT 1 /* Index with the BMI2 PEXT instruction */
+typedef struct {
+    U64 *attacks; /* This square's slice of slider_attacks */
+    U64 mask; /* Relevant blocker squares */
+    U64 magic; /* Magic number */
+    int shift; /* 64 - index bits */
+} magic_t;
+extern U64 slider_attacks[SLIDER_TABLE_SIZE];
+extern magic_t rook_table[64];
+extern magic_t bishop_table[64];
+extern int slider_backend;
+static inline int magic_index(const magic_t *entry, U64 occupied) {
+    /* Index of the attacks for the given occupancy in the square's slice, by magic multiplication */
+    return ((occupied & entry->mask) * entry->magic) >> entry->shift;
+}
+static inline int pext_index(const magic_t *entry, U64 occupied) {
+    /* Same with PEXT (only used when pext_supported) */
+#ifdef __x86_64__
+    U64 index;
+    __asm__("pextq %2, %1, %0" : "=r"(index) : "r"(occupied), "r"(entry->mask)); /* Gather the blocker bits, no -mbmi2 needed for the rest of the build */
+    return index;
+#else
+    return magic_index(entry, occupied);
+#endif
+}
 void test_rook_table(int square);
 void init_rook_square_table(int square);
 U64 rook_attack_loop(int square, U64 blockers);
-extern U64 rook_attacks[64][4096];
-extern U64 bishop_attacks[64][4096];
+int pext_supported();
+void set_slider_backend(int backend);
 void init_magic_tables();
 #endif
@@ -1,5 +1,7 @@
 /* header file for king_moves.c */
 #ifndef MOVEGEN_KINGMOVES_H
 #define MOVEGEN_KINGMOVES_H
-void generate_king_moves(move_list_t *move_list, Bitboard *board);
+void generate_king_moves(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_king_moves_w(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_king_moves_b(move_list_t *move_list, Bitboard *board, int gen_type);
 #endif
@@ -11,14 +11,13 @@
 #include "lookup_tables.h"
 #include "move_gen_utils.h"
 
-void add_knight_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int knight_index, U64 enemy_mask); /* Forward decleration */
+SIDE_INLINE void add_knight_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int knight_index, U64 enemy_mask, const int side); /* Forward decleration */
 
-void generate_knight_moves(move_list_t *move_list, Bitboard *board) {
+SIDE_INLINE void generate_knight_moves_side(move_list_t *move_list, Bitboard *board, int gen_type, const int side) {
     /* Generates all knight moves and adds them to move list */
     // Masks
-    int side = board->side; /* Side to move */
-    U64 own_mask = colour_mask(board, side); /* Piece mask of own side */
-    U64 enemy_mask = colour_mask(board, !side); /* Piece mask of enemy pieces */
+    U64 own_mask = board->occupancy[side]; /* Piece mask of own side */
+    U64 enemy_mask = board->occupancy[!side]; /* Piece mask of enemy pieces */
     // Declare for loop
     U64 knights = (side) ? board->pieces[knight_w] : board->pieces[knight_b]; /* Knights bitboard */
     U64 position = 0; /* Knight position (current bit) */
@@ -29,16 +28,15 @@ void generate_knight_moves(move_list_t *move_list, Bitboard *board) {
         position = knights & -knights; /* Get next knight */
         knight_index = bitscan(position); /* Get the index of the knight */
         move_set = knight_attacks[knight_index]; /* Lookup knight moves */
-        move_set &= ~own_mask; /* Remove blocked squares */
-        add_knight_moves(move_set, board, move_list, knight_index, enemy_mask); /* Add all moves to moves list */
+        move_set &= target_mask(own_mask, enemy_mask, gen_type); /* Remove blocked squares (and the squares we don't want) */
+        add_knight_moves(move_set, board, move_list, knight_index, enemy_mask, side); /* Add all moves to moves list */
         // Reset LSB
         knights ^= position; /* Move to next knight */
     }
 }
 
-void add_knight_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int knight_index, U64 enemy_mask) {
+SIDE_INLINE void add_knight_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int knight_index, U64 enemy_mask, const int side) {
     /* Add all knight moves to move list */
-    int side = board->side; /* Makes code writing easier */
     // Declare for loop
     U64 position;
     U64 cap_flag; /* Check if move is a capture */
@@ -50,7 +48,7 @@ void add_knight_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int
         position = move_set & -move_set; /* Get next move */
         pos_index = bitscan(position); /* Get index of to move */
         cap_flag = position & enemy_mask; /* Check if this is a capture */
-        if (cap_flag) cap_piece = get_captured_piece(board, position, side); /* Get captured piece id (if there is one) */
+        if (cap_flag) cap_piece = board->mailbox[pos_index]; /* Get captured piece id (if there is one) */
         move = set_move(knight_index /* from */, pos_index /* to */, (side) ? knight_w : knight_b /* Piece */, (cap_flag) ? cap_piece : 0 /* Captured Piece */); /* Set the move */
         // Set flags
         if (cap_flag) move |= MM_CAP; /* If this is a capture move, set the capture flag */
@@ -59,3 +57,5 @@ void add_knight_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int
         move_set ^= position; /* Remove move from set (Reset LSB) */
     }
 }
+
+SIDE_SPECIALIZED_GENERATOR(generate_knight_moves)
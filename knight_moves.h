@@ -1,5 +1,7 @@
 /* header file for knight_moves.c */
 #ifndef MOVEGEN_KNIGHTMOVES_H /* Do I really have to say this is a header guard? */
 #define MOVEGEN_KNIGHTMOVES_H /* I think I should know that by now */
-void generate_knight_moves(move_list_t *move_list, Bitboard *board);
+void generate_knight_moves(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_knight_moves_w(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_knight_moves_b(move_list_t *move_list, Bitboard *board, int gen_type);
 #endif
@@ -0,0 +1,173 @@
+/* legal_moves.c
+ * Legal move generation.
+ * The checkers and pinned pieces are found once per position, so that the legality of each move is a few bitwise operations.
+ * No moves have to be made and unmade like is_legal does (which is still there, to cross check this in perft).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "bitboards.h"
+#include "bitboard_utils.h"
+#include "moves.h"
+#include "move_utils.h"
+#include "lookup_tables.h"
+#include "pawn_moves.h"
+#include "knight_moves.h"
+#include "rook_moves.h"
+#include "bishop_moves.h"
+#include "queen_moves.h"
+#include "king_moves.h"
+#include "castling_moves.h"
+#include "generate_moves.h"
+#include "make_move.h"
+#include "legality_test.h"
+#include "see.h"
+#include "legal_moves.h"
+
+U64 between_squares(int a, int b) {
+    /* Squares strictly between two squares on the same rank, file or diagonal (0 if they aren't lined up) */
+    U64 a_position = 1ULL << a, b_position = 1ULL << b;
+    if (magic_rook_moves(a, 0, 0) & b_position) /* Same rank or file, the rays from each square stopped by the other only meet in between */
+        return magic_rook_moves(a, 0, b_position) & magic_rook_moves(b, 0, a_position);
+    if (magic_bishop_moves(a, 0, 0) & b_position) /* Same diagonal */
+        return magic_bishop_moves(a, 0, b_position) & magic_bishop_moves(b, 0, a_position);
+    return 0;
+}
+
+void get_legal_info(Bitboard *board, legal_info_t *info) {
+    /* Find the checkers, the pinned pieces and the squares they can move to */
+    int side = board->side;
+    int offset = side ? 6 : 0; /* Enemy piece ids */
+    U64 own = board->occupancy[side];
+    U64 occupied = board->occupied;
+    U64 queens = board->pieces[queen_w + offset];
+    int king = bitscan(board->pieces[side ? king_w : king_b]);
+    info->king = king;
+    info->pinned = 0;
+    // Pieces giving check
+    info->checkers = ((side ? pawn_attacks_w : pawn_attacks_b)[king] & board->pieces[pawn_w + offset]) /* Enemy pawns on the squares our pawn would attack */
+                   | (knight_attacks[king] & board->pieces[knight_w + offset]);
+    // Sliding pieces lined up with the king check it if nothing is in between, and pin the piece in between if there is exactly one of ours
+    U64 snipers = (magic_rook_moves(king, 0, 0) & (board->pieces[rook_w + offset] | queens))
+                | (magic_bishop_moves(king, 0, 0) & (board->pieces[bishop_w + offset] | queens));
+    while (snipers) {
+        int sniper = bitscan(snipers);
+        U64 between = between_squares(king, sniper);
+        U64 blockers = between & occupied;
+        if (!blockers) info->checkers |= 1ULL << sniper; /* Check */
+        else if (!(blockers & (blockers - 1)) && (blockers & own)) { /* A single piece of ours in the way (pinned) */
+            info->pinned |= blockers;
+            info->pin_rays[bitscan(blockers)] = between | (1ULL << sniper); /* It can still move along the pin, or capture the pinning piece */
+        }
+        snipers &= snipers - 1; /* Reset LSB */
+    }
+    // Squares that get out of check
+    if (!info->checkers) info->check_mask = ~0ULL; /* Not in check, anywhere goes */
+    else if (info->checkers & (info->checkers - 1)) info->check_mask = 0; /* Double check, only the king can move */
+    else info->check_mask = info->checkers | between_squares(king, bitscan(info->checkers)); /* Capture or block the checker */
+}
+
+int legal_move(Bitboard *board, move_t move, legal_info_t *info) {
+    /* Check if a pseudo-legal move is legal, using the information from get_legal_info */
+    int side = board->side;
+    int from = move & MM_FROM;
+    int to = (move & MM_TO) >> MS_TO;
+    int piece = (move & MM_PIECE) >> MS_PIECE;
+    U64 to_position = 1ULL << to;
+    if (move & MM_CAS) { /* Not out of, through or into check */
+        int step = (move & MM_CSD) ? -1 : 1; /* Queen side or king side */
+        return !info->checkers && !square_attacked(board, info->king + step, !side) && !square_attacked(board, info->king + 2 * step, !side); /* (Castling moves don't have a from square) */
+    }
+    if (piece == king_w || piece == king_b) /* The king can't move to an attacked square (with the king itself not blocking the sliders behind it) */
+        return !square_attacked_by(board, to, !side, board->occupied ^ (1ULL << from));
+    if (move & MM_EPC) { /* Two pawns leave the same rank at once, so check the whole position after the capture */
+        int captured = side ? to - 8 : to + 8;
+        U64 occupied = board->occupied ^ (1ULL << from) ^ to_position ^ (1ULL << captured);
+        return !(attackers_to(board, info->king, occupied) & occupied & board->occupancy[!side]); /* The captured pawn drops out, since it isn't occupied any more */
+    }
+    if (!(to_position & info->check_mask)) return 0; /* Doesn't deal with the check */
+    if (info->pinned & (1ULL << from)) return (to_position & info->pin_rays[from]) != 0; /* Pinned pieces can only move along the pin */
+    return 1;
+}
+
+void generate_legal_moves_type(Bitboard *board, move_list_t *moves, int gen_type, legal_info_t *info) {
+    /* Generate the legal moves of a certain type (see moves.h), the info has to be from get_legal_info */
+    int start = moves->count; /* The list might already have moves, only filter the new ones */
+    if (info->checkers) { /* Check evasions */
+        generate_king_moves(moves, board, gen_type); /* The king can always try to move away */
+        if (info->check_mask) { /* Single check, the other pieces can capture or block the checker (no castling) */
+            generate_pawn_moves(moves, board, gen_type);
+            generate_knight_moves(moves, board, gen_type);
+            generate_rook_moves(moves, board, gen_type);
+            generate_bishop_moves(moves, board, gen_type);
+            generate_queen_moves(moves, board, gen_type);
+        }
+    } else generate_moves_type(board, moves, gen_type);
+    // Filter out the illegal moves
+    int count = start;
+    for (int index = start; index < moves->count; index++) {
+        if (legal_move(board, moves->moves[index], info)) moves->moves[count++] = moves->moves[index];
+    }
+    moves->count = count;
+}
+
+void generate_legal_moves(Bitboard *board, move_list_t *moves) {
+    /* Generate all legal moves */
+    legal_info_t info;
+    get_legal_info(board, &info);
+    generate_legal_moves_type(board, moves, gen_all, &info);
+}
+
+void generate_legal_captures(Bitboard *board, move_list_t *moves) {
+    /* Generate legal captures and promotions */
+    legal_info_t info;
+    get_legal_info(board, &info);
+    generate_legal_moves_type(board, moves, gen_captures, &info);
+}
+
+void generate_legal_quiets(Bitboard *board, move_list_t *moves) {
+    /* Generate legal quiet moves */
+    legal_info_t info;
+    get_legal_info(board, &info);
+    generate_legal_moves_type(board, moves, gen_quiets, &info);
+}
+
+int gives_check(Bitboard *board, move_t move) {
+    /* Check if a move gives check without making it (castling, en passant and promotions are just made and tested) */
+    if (move & (MM_CAS | MM_EPC | MM_PRO)) { /* Rare, not worth the special cases */
+        make_move(board, move);
+        int check = is_check(board, board->side);
+        unmake_move(board, move);
+        return check;
+    }
+    int side = board->side;
+    int own = side ? 0 : 6; /* Own piece ids */
+    U64 king = board->pieces[side ? king_b : king_w]; /* Enemy king */
+    if (!king) return 0; /* No king to attack (only in test positions) */
+    int king_square = bitscan(king);
+    int from = move & MM_FROM, to = (move & MM_TO) >> MS_TO;
+    int piece = (move & MM_PIECE) >> MS_PIECE;
+    U64 from_position = 1ULL << from;
+    U64 occupied = (board->occupied ^ from_position) | (1ULL << to); /* Occupancy after the move */
+    // Direct check from the moved piece
+    switch (piece - own) {
+        case pawn_w:
+            if ((side ? pawn_attacks_w : pawn_attacks_b)[to] & king) return 1;
+            break;
+        case knight_w:
+            if (knight_attacks[to] & king) return 1;
+            break;
+        case bishop_w:
+            if (magic_bishop_moves(to, 0, occupied) & king) return 1;
+            break;
+        case rook_w:
+            if (magic_rook_moves(to, 0, occupied) & king) return 1;
+            break;
+        case queen_w:
+            if ((magic_rook_moves(to, 0, occupied) | magic_bishop_moves(to, 0, occupied)) & king) return 1;
+            break;
+    }
+    // Discovered check from a slider behind the from square (not counting the moved piece, which was covered above)
+    U64 queens = board->pieces[queen_w + own];
+    return (magic_bishop_moves(king_square, 0, occupied) & (board->pieces[bishop_w + own] | queens) & ~from_position)
+        || (magic_rook_moves(king_square, 0, occupied) & (board->pieces[rook_w + own] | queens) & ~from_position);
+}
@@ -0,0 +1,22 @@
+/* Header file for legal_moves.c */
+#ifndef LEGALMOVES_H
+#define LEGALMOVES_H
+
+typedef struct legal_info_t {
+    /* What makes a move illegal in a position, found once per node */
+    int king; /* Square of the king of the side to move */
+    U64 checkers; /* Enemy pieces giving check */
+    U64 check_mask; /* Squares a piece other than the king must move to (everything when not in check, the checker and the squares in between in single check, nothing in double check) */
+    U64 pinned; /* Own pieces pinned to the king */
+    U64 pin_rays[64]; /* Squares each pinned piece can still move to (only set for the pinned pieces) */
+} legal_info_t;
+
+U64 between_squares(int a, int b);
+void get_legal_info(Bitboard *board, legal_info_t *info);
+int legal_move(Bitboard *board, move_t move, legal_info_t *info);
+void generate_legal_moves_type(Bitboard *board, move_list_t *moves, int gen_type, legal_info_t *info);
+void generate_legal_moves(Bitboard *board, move_list_t *moves);
+void generate_legal_captures(Bitboard *board, move_list_t *moves);
+void generate_legal_quiets(Bitboard *board, move_list_t *moves);
+int gives_check(Bitboard *board, move_t move);
+#endif
@@ -14,6 +14,8 @@
 #include "move_gen_utils.h"
 #include "lookup_tables.h"
 #include "make_move.h"
+#include "castling_moves.h"
+#include "legality_test.h"
 
 U64 pawn_attack_mask(Bitboard *board, int side) {
     /* Generate all attacked squares of pawns, to check if king is attacked */
@@ -99,47 +101,45 @@ U64 queen_attack_mask(Bitboard *board, int side, U64 own, U64 enemy) {
 }
 
 void update_attack_table(Bitboard *board, int piece) {
-    /* Update the attack table of a certian piece */
-    int side = piece < 6; /* Side */
-    U64 own = colour_mask(board, side); /* Own colour mask */
-    U64 enemy = colour_mask(board, !side); /* Enemy colour mask */
+    /* Update the attack table of a certian piece (each case passes its side as a constant) */
+    U64 white = board->occupancy[1], black = board->occupancy[0]; /* Colour masks */
     switch (piece) { /* Depending on the piece, update attack mask */
         case rook_w:
-            board->attack_tables[piece] = rook_attack_mask(board, side, own, enemy);
+            board->attack_tables[piece] = rook_attack_mask(board, 1, white, black);
             break;
         case knight_w:
-            board->attack_tables[piece] = knight_attack_mask(board, side);
+            board->attack_tables[piece] = knight_attack_mask(board, 1);
             break;
         case bishop_w:
-            board->attack_tables[piece] = bishop_attack_mask(board, side, own, enemy);
+            board->attack_tables[piece] = bishop_attack_mask(board, 1, white, black);
             break;
         case queen_w:
-            board->attack_tables[piece] = queen_attack_mask(board, side, own, enemy);
+            board->attack_tables[piece] = queen_attack_mask(board, 1, white, black);
             break;
         case king_w:
-            board->attack_tables[piece] = king_attack_mask(board, side);
+            board->attack_tables[piece] = king_attack_mask(board, 1);
             break;
         case pawn_w:
-            board->attack_tables[piece] = pawn_attack_mask(board, side);
+            board->attack_tables[piece] = pawn_attack_mask(board, 1);
             break;
         // Black pieces
         case rook_b:
-            board->attack_tables[piece] = rook_attack_mask(board, side, own, enemy);
+            board->attack_tables[piece] = rook_attack_mask(board, 0, black, white);
             break;
         case knight_b:
-            board->attack_tables[piece] = knight_attack_mask(board, side);
+            board->attack_tables[piece] = knight_attack_mask(board, 0);
             break;
         case bishop_b:
-            board->attack_tables[piece] = bishop_attack_mask(board, side, own, enemy);
+            board->attack_tables[piece] = bishop_attack_mask(board, 0, black, white);
             break;
         case queen_b:
-            board->attack_tables[piece] = queen_attack_mask(board, side, own, enemy);
+            board->attack_tables[piece] = queen_attack_mask(board, 0, black, white);
             break;
         case king_b:
-            board->attack_tables[piece] = king_attack_mask(board, side);
+            board->attack_tables[piece] = king_attack_mask(board, 0);
             break;
         case pawn_b:
-            board->attack_tables[piece] = pawn_attack_mask(board, side);
+            board->attack_tables[piece] = pawn_attack_mask(board, 0);
             break;
     }
 }
@@ -154,37 +154,51 @@ void update_sliding_piece_attacks(Bitboard *board) {
     update_attack_table(board, rook_b);
     update_attack_table(board, bishop_b);
     update_attack_table(board, queen_b);
+    board->stale_sliders = 0; /* Up to date now */
+}
+
+U64 attack_table(Bitboard *board, int piece) {
+    /* Get the attack table of a piece.
+     * make_move only marks the sliding piece tables as stale, since any move can change them and most positions never look at them.
+     * They are updated here the first time they are needed.
+    */
+    if (board->stale_sliders && is_slider(piece)) update_sliding_piece_attacks(board);
+    return board->attack_tables[piece];
+}
+
+SIDE_INLINE int square_attacked_side(Bitboard *board, int square, const int side, U64 occupied) {
+    /* Check if any piece of a side attacks a square, with the sliding pieces blocked by the given occupancy (looks from the square outwards, so no attack tables are needed) */
+    int offset = side ? 0 : 6; /* Black piece ids are the white ones + 6 */
+    U64 queens = board->pieces[queen_w + offset];
+    return ((side ? pawn_attacks_b : pawn_attacks_w)[square] & board->pieces[pawn_w + offset]) /* Pawns attack the squares an enemy pawn here would attack */
+        || (knight_attacks[square] & board->pieces[knight_w + offset])
+        || (king_attacks[square] & board->pieces[king_w + offset])
+        || (magic_bishop_moves(square, 0, occupied) & (board->pieces[bishop_w + offset] | queens))
+        || (magic_rook_moves(square, 0, occupied) & (board->pieces[rook_w + offset] | queens));
+}
+
+int square_attacked_by(Bitboard *board, int square, int side, U64 occupied) {
+    /* Check if a side attacks a square with the given occupancy, specialized for the attacking side */
+    return side ? square_attacked_side(board, square, 1, occupied) : square_attacked_side(board, square, 0, occupied);
+}
+
+int square_attacked(Bitboard *board, int square, int side) {
+    /* Check if any piece of a side attacks a square */
+    return square_attacked_by(board, square, side, board->occupied);
 }
 
 int is_check(Bitboard *board, int side) {
     /* Detects if the king of any colour is under check */
-    U64 own = colour_mask(board, side); /* Own colour mask */
-    U64 enemy = colour_mask(board, !side); /* Enemy colour mask */
-    U64 attacks = 0
-        | board->attack_tables[side ? pawn_b : pawn_w] /* Add the pawn attacks */
-        | board->attack_tables[side ? knight_b : knight_w] /* Knight attacks */
-        | board->attack_tables[side ? king_b : king_w] /* Ok, it seems obvious where we are going */
-        | board->attack_tables[side ? rook_b : rook_w]
-        | board->attack_tables[side ? bishop_b : bishop_w]
-        | board->attack_tables[side ? queen_b : queen_w]; /* Ok now we have got all the attacked squares by the enemy */
-    // Check if the king intersects with the attacks
-    if (board->pieces[side ? king_w : king_b] & attacks) return 1; /* Check! */
-    else return 0; /* Not check */
+    U64 king = board->pieces[side ? king_w : king_b];
+    if (!king) return 0; /* No king to attack (only in test positions) */
+    if (side) return square_attacked_side(board, bitscan(king), 0, board->occupied); /* Check! (or not) */
+    return square_attacked_side(board, bitscan(king), 1, board->occupied);
 }
 
 int castling_legality(Bitboard *board, move_t move) {
     /* Special legality test for castling */
     int side = board->side;
-    U64 own = colour_mask(board, side); /* Own colour mask */
-    U64 enemy = colour_mask(board, !side); /* Enemy colour mask */
     int legality = 1;
-    U64 attacks = 0
-        | board->attack_tables[side ? pawn_b : pawn_w] /* Add the pawn attacks */
-        | board->attack_tables[side ? knight_b : knight_w] /* Knight attacks */
-        | board->attack_tables[side ? king_b : king_w] /* Ok, it seems obvious where we are going */
-        | board->attack_tables[side ? rook_b : rook_w]
-        | board->attack_tables[side ? bishop_b : bishop_w]
-        | board->attack_tables[side ? queen_b : queen_w]; /* Ok now we have got all the attacked squares by the enemy */
     if (is_check(board, board->side)) legality = 0; /* Castling while checked is not allowed */
     U64 king_jumpover; /* The square that the king jumps over */
     if (board->side) { /* White castles */
@@ -194,17 +208,69 @@ int castling_legality(Bitboard *board, move_t move) {
         if (move & MM_CSD) king_jumpover = 0x0800000000000000;
         else king_jumpover = 0x2000000000000000;
     }
-    if (attacks & king_jumpover) legality = 0; /* King jumps over attacked square (Illegal!!) */
+    if (square_attacked(board, bitscan(king_jumpover), !side)) legality = 0; /* King jumps over attacked square (Illegal!!) */
     return legality;
 }
 
 int is_legal(Bitboard *board, move_t move) {
     /* Return true if the move is legal, otherwise return false */
-    U64 enpas, castling_rights, key; int ps_eval; /* For unmaking move */
     int legality;
-    make_move(board, move, &enpas, &castling_rights, &key, &ps_eval); /* We Make the Move !! */
+    make_move(board, move); /* We Make the Move !! */
     legality = !is_check(board, !(board->side)); /* Check if the king is now under check (What if the king isn't even there? Don't think that's possible) */
-    unmake_move(board, move, &enpas, &castling_rights, &key, &ps_eval); /* We take back the move */
+    unmake_move(board, move); /* We take back the move */
     if (move & MM_CAS) /* If this is a castling move */ legality = legality && castling_legality(board, move); /* Do special legality test */
     return legality;
 }
+
+int is_pseudo_legal(Bitboard *board, move_t move) {
+    /* Check that a move (probably from the tp table) could have been generated in this position.
+     * Much cheaper than generating all the moves and looking for it.
+    */
+    int side = board->side;
+    if (!move) return 0; /* No move */
+    if (move & MM_CAS) { /* Castling, just generate the castling moves and look for it */
+        move_list_t castling = {0,0};
+        generate_castling_moves(&castling, board, gen_all);
+        for (int index = 0; index < castling.count; index++) if (castling.moves[index] == move) return 1;
+        return 0;
+    }
+    int from = move & MM_FROM; /* Get the from square */
+    int to = (move & MM_TO) >> MS_TO; /* Get the to square */
+    int piece = (move & MM_PIECE) >> MS_PIECE; /* Piece type id */
+    int cap_piece = (move & MM_EAT) >> MS_EAT; /* Captured piece id */
+    U64 own = board->occupancy[side]; /* Own colour mask */
+    U64 enemy = board->occupancy[!side]; /* Enemy colour mask */
+    U64 to_position = 1ULL << to;
+
+    // Check the pieces
+    if ((piece < 6) != side) return 0; /* Not our piece */
+    if (board->mailbox[from] != piece) return 0; /* The piece isn't there */
+    if (move & MM_CAP) { /* Capture */
+        if (cap_piece >= 12 || (cap_piece < 6) == side) return 0; /* Can't capture our own pieces */
+        if (board->mailbox[to] != cap_piece) return 0; /* The captured piece isn't there */
+    } else if (board->mailbox[to] != NO_PIECE) return 0; /* Quiet moves need an empty square */
+
+    // Check that the piece can move there
+    switch (piece) {
+        case knight_w: case knight_b:
+            return (knight_attacks[from] & to_position) != 0;
+        case king_w: case king_b:
+            return (king_attacks[from] & to_position) != 0;
+        case rook_w: case rook_b:
+            return (magic_rook_moves(from, own, enemy) & to_position) != 0;
+        case bishop_w: case bishop_b:
+            return (magic_bishop_moves(from, own, enemy) & to_position) != 0;
+        case queen_w: case queen_b:
+            return (magic_queen_moves(from, own, enemy) & to_position) != 0;
+    }
+    // Pawn moves
+    U64 attacks = side ? pawn_attacks_w[from] : pawn_attacks_b[from]; /* Pawn captures */
+    int forward = side ? 8 : -8; /* Push direction */
+    if (((move & MM_PRO) != 0) != ((to_position & ranks[side ? 56 : 0]) != 0)) return 0; /* Promotion is compulsary on the last rank (and only there) */
+    if (move & MM_EPC) /* En-passant capture, to the en-passant file on the 6th (or 3rd) rank */
+        return (attacks & to_position & board->enpas & ranks[side ? 40 : 16]) != 0;
+    if (move & MM_CAP) return (attacks & to_position) != 0; /* Normal capture */
+    if (move & MM_DPP) /* Double push, from the 2nd (or 7th) rank over an empty square */
+        return to == from + 2 * forward && (ranks[from] == ranks[side ? 8 : 48]) && !((own | enemy) & (1ULL << (from + forward)));
+    return to == from + forward; /* Single push */
+}
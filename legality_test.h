@@ -9,8 +9,13 @@ U64 king_attack_mask(Bitboard *board, int side);
 U64 rook_attack_mask(Bitboard *board, int side, U64 own, U64 enemy);
 U64 bishop_attack_mask(Bitboard *board, int side, U64 own, U64 enemy);
 U64 queen_attack_mask(Bitboard *board, int side, U64 own, U64 enemy);
+#define is_slider(piece) ((piece) % 6 != knight_w && (piece) % 6 < king_w) /* Rooks, bishops and queens */
+int square_attacked(Bitboard *board, int square, int side);
+int square_attacked_by(Bitboard *board, int square, int side, U64 occupied);
 int is_check(Bitboard *board, int side);
 int is_legal(Bitboard *board, move_t move);
+int is_pseudo_legal(Bitboard *board, move_t move);
 void update_sliding_piece_attacks(Bitboard *board);
 void update_attack_table(Bitboard *board, int piece);
+U64 attack_table(Bitboard *board, int piece);
 #endif
@@ -44,6 +44,8 @@
 #include "zobrist_hash.h"
 #include "tp_table.h"
 #include "gui_game.h"
+#include "bench.h"
+#include "time_manager.h"
 #define INF INT_MAX
 
 int main(int argc, char **argv) {
@@ -61,13 +63,41 @@ int main(int argc, char **argv) {
         'R','N','B','Q','K','B','N','R',    
     }; /* An Array of characters as the starting board state */
     // Initialize pre-initialized data */
-    init_tp_table();
     init_hash_keys();
     init_magic_tables();
+    init_search_tables();
     // Initialize the board */
     Bitboard board = {0,0,0,0}; /* Allocate space for bitboard */
     init_board(&board, initial_state, 1);
 
+    // Parse options (these can be anywhere in the arguments)
+    int run_benchmarks = 0; /* Run the benchmarks instead of playing */
+    int bench_depth = BENCH_DEPTH; /* Depth for the benchmarks */
+    int hash_size = TP_SIZE; /* TP Table size in megabytes */
+    int positional = 1; /* Number of arguments left after removing the options */
+    for (int i = 1; i < argc; i++) { /* Loop through the arguments */
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) search_threads = atoi(argv[++i]); /* Number of search threads */
+        else if (!strcmp(argv[i], "--hash") && i + 1 < argc) hash_size = atoi(argv[++i]); /* TP Table size in megabytes */
+        else if (!strcmp(argv[i], "--move-overhead") && i + 1 < argc) move_overhead = atoi(argv[++i]); /* Time (ms) kept aside for each move */
+        else if (!strcmp(argv[i], "--futility-margin") && i + 1 < argc) futility_margin = atoi(argv[++i]); /* Futility pruning margin per ply */
+        else if (!strcmp(argv[i], "--rfp-margin") && i + 1 < argc) reverse_futility_margin = atoi(argv[++i]); /* Reverse futility pruning margin per ply */
+        else if (!strcmp(argv[i], "--lmp-base") && i + 1 < argc) lmp_base = atoi(argv[++i]); /* Quiet moves searched before late move pruning */
+        else if (!strcmp(argv[i], "bench")) { /* Run benchmarks */
+            run_benchmarks = 1;
+            if (i + 1 < argc && atoi(argv[i + 1]) > 0) bench_depth = atoi(argv[++i]); /* Optional bench depth */
+        }
+        else argv[positional++] = argv[i]; /* Not an option, keep it */
+    }
+    argc = positional;
+    if (search_threads < 1) search_threads = 1; /* Clamp the thread count */
+    if (search_threads > MAX_THREADS) search_threads = MAX_THREADS;
+    init_tp_table(hash_size); /* Allocate the TP Table, now that its size is known */
+
+    if (run_benchmarks) { /* Benchmark instead of playing */
+        run_bench(bench_depth);
+        return 0;
+    }
+
     // Start a game with the GUI 
     int human_side = 1; /* The side of the human to play */
     char log_filepath[512] = {0}; /* Log file path */
@@ -1,10 +1,12 @@
 /* make_move.c *
  * This file contains the function to make/unmake the move on the board
- * The make move function requires to store some extra data for the unmake function later on.
+ * The make move function saves the state it can't reverse in the board's undo stack, at the slot for the current move count.
+ * Unmake restores it from there, and only has to move the pieces back.
 */
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <string.h>
 #include "bitboards.h"
 #include "bitboard_utils.h"
 #include "moves.h"
@@ -28,14 +30,46 @@
 #define CAS_KING_BQ 0x1400000000000000
 #define CAS_ROOK_BQ 0x0900000000000000
 
-void make_move(Bitboard *board, move_t move, U64 *enpas_file, U64 *castling_rights, U64 *key /* Better just save this rather than incremental update, saves more time writing code */, int *piece_square_eval) {
-    /* Make the move on the move structure on the bitboard */
+/* Undo records live outside the board, so that copying a board (e.g. for each search thread) stays cheap.
+ * Each thread has its own stack, so a move has to be unmade on the thread that made it.
+ * Boards on the same thread share it, which is fine as long as each one only unmakes its own moves, since a board only writes at and above its move count.
+*/
+__thread undo_t undo_stack[UNDO_STACK_SIZE]; /* One undo record per ply, indexed by the move count */
+
+undo_t *undo_record(Bitboard *board) {
+    /* The undo record of the current ply */
+    return &undo_stack[board->moves & (UNDO_STACK_SIZE - 1)];
+}
+
+SIDE_INLINE void castle_mailbox(Bitboard *board, const int side, int queen_side, int undo) {
+    /* Move the king and rook in the mailbox for a castling move (or move them back) */
+    int king_from = side ? 4 : 60; /* e1 or e8 */
+    int king_to = queen_side ? king_from - 2 : king_from + 2;
+    int rook_from = queen_side ? king_from - 4 : king_from + 3;
+    int rook_to = queen_side ? king_from - 1 : king_from + 1;
+    if (undo) { /* Swap them, to move the pieces back */
+        int square = king_from; king_from = king_to; king_to = square;
+        square = rook_from; rook_from = rook_to; rook_to = square;
+    }
+    board->mailbox[king_from] = board->mailbox[rook_from] = NO_PIECE;
+    board->mailbox[king_to] = side ? king_w : king_b;
+    board->mailbox[rook_to] = side ? rook_w : rook_b;
+}
+
+SIDE_INLINE void make_move_side(Bitboard *board, move_t move, const int side) {
+    /* Make the move on the move structure on the bitboard (side is the side to move, see make_move) */
     // Set saved values for unmake
-    int side = board->side; /* Convenience reasons */
-    *enpas_file = board->enpas; /* Set the en passant file */
-    *castling_rights = board->castling_rights; /* Set the old castling rights */
-    *key = board->key; /* Save programming time */
-    *piece_square_eval = board->piece_square_eval; /* Save the evaluation term for piece-square tables */
+    undo_t *undo = undo_record(board); /* Save the state here */
+    undo->enpas = board->enpas; /* Set the en passant file */
+    undo->castling_rights = board->castling_rights; /* Set the old castling rights */
+    undo->key = board->key; /* Save programming time */
+    undo->pawn_key = board->pawn_key;
+    undo->piece_square_eval = board->piece_square_eval; /* Save the evaluation term for piece-square tables */
+    memcpy(undo->attack_tables, board->attack_tables, sizeof(board->attack_tables)); /* Save the attack tables, so that unmake doesn't have to regenerate them */
+    undo->stale_sliders = board->stale_sliders;
+    undo->occupancy[0] = board->occupancy[0]; /* Save the occupancy */
+    undo->occupancy[1] = board->occupancy[1];
+    undo->occupied = board->occupied;
     
     // Handle castling moves
     if (move & MM_CAS) { /* If this is a castling move */
@@ -43,15 +77,19 @@ void make_move(Bitboard *board, move_t move, U64 *enpas_file, U64 *castling_righ
         if (side) { /* If white is castling */
             board->pieces[king_w] ^= (move & MM_CSD) ? CAS_KING_WQ : CAS_KING_WK; /* Move the king */
             board->pieces[rook_w] ^= (move & MM_CSD) ? CAS_ROOK_WQ : CAS_ROOK_WK; /* Move the rook */
+            board->occupancy[1] ^= (move & MM_CSD) ? CAS_KING_WQ | CAS_ROOK_WQ : CAS_KING_WK | CAS_ROOK_WK; /* Both of them */
         } else { /* If black is castling */
             board->pieces[king_b] ^= (move & MM_CSD) ? CAS_KING_BQ : CAS_KING_BK; /* Move the king */
             board->pieces[rook_b] ^= (move & MM_CSD) ? CAS_ROOK_BQ : CAS_ROOK_BK; /* Move the rook */
+            board->occupancy[0] ^= (move & MM_CSD) ? CAS_KING_BQ | CAS_ROOK_BQ : CAS_KING_BK | CAS_ROOK_BK; /* Both of them */
         }
+        board->occupied = board->occupancy[0] | board->occupancy[1];
+        castle_mailbox(board, side, move & MM_CSD, 0);
         board->enpas = 0; /* Disable en-passant capture */
 
         // Update attack tables
         update_attack_table(board, side ? king_w : king_b); /* Update king attack table */
-        update_sliding_piece_attacks(board); /* Update the sliding piece attack table, since that can be affected by moving blockers */
+        board->stale_sliders = 1; /* The sliding piece attack tables are updated when they are needed (see attack_table) */
         
         // Update piece-square tables
         U64 cas_side = move & MM_CSD;
@@ -59,7 +97,7 @@ void make_move(Bitboard *board, move_t move, U64 *enpas_file, U64 *castling_righ
         else board->piece_square_eval -= cas_side ? 15 : 35; /* Add the castling advantage to the pst*/
         update_key_castle(board, side, cas_side); /* Update the zobrist hash key while castling */
         board->castling_rights &= ~(side ? W_CASTLE : B_CASTLE); /* Update castling rights */
-        board->side = !board->side; /* Toggle side-to-move */
+        board->side = !side; /* Toggle side-to-move */
         board->moves++; /* Plus plus the move count */
         return;
     }
@@ -74,13 +112,15 @@ void make_move(Bitboard *board, move_t move, U64 *enpas_file, U64 *castling_righ
     // Pawn promotion Move
     if (move & MM_PRO) { /* If this is a pawn promotion move */
         board->pieces[piece] ^= 1ULL << from; /* Remove piece */
-        board->pieces[board->side ? promoted : promoted + 6] ^= 1ULL << to; /* Appear as promoted piece */
+        board->pieces[side ? promoted : promoted + 6] ^= 1ULL << to; /* Appear as promoted piece */
         if (move & MM_CAP) /* If this is a capture move */ board->pieces[cap_piece] ^= 1ULL << to; /* Remove captured piece from board */
+        board->occupancy[side] ^= (1ULL << from) | (1ULL << to); /* Update the occupancy */
+        if (move & MM_CAP) board->occupancy[!side] ^= 1ULL << to;
         // Update zobrist key
-        update_key_prom(board, piece, from, to, board->side ? promoted : promoted + 6, move & MM_CAP, cap_piece); /* Update the zobrist hash */ 
+        update_key_prom(board, piece, from, to, side ? promoted : promoted + 6, move & MM_CAP, cap_piece); /* Update the zobrist hash */ 
         // Update Piece-square Tables
         board->piece_square_eval -= piece_square[piece][from]; /* Remove from-square */
-        board->piece_square_eval += piece_square[board->side ? promoted : promoted + 6][to]; /* Add promoted piece on to-square */
+        board->piece_square_eval += piece_square[side ? promoted : promoted + 6][to]; /* Add promoted piece on to-square */
         if (move & MM_CAP) board->piece_square_eval -= piece_square[cap_piece][to]; /* Remove captured piece (if so) */
     }
     // En-passant capture
@@ -88,6 +128,8 @@ void make_move(Bitboard *board, move_t move, U64 *enpas_file, U64 *castling_righ
         board->pieces[piece] ^= (1ULL << from) | (1ULL << to); /* Move the piece to the correct square */
         U64 ep_cap_pos = ranks[side ? 32 : 24] /* Capture rank */ & board->enpas; /* Capture file */
         board->pieces[(side) ? pawn_b : pawn_w] ^= ep_cap_pos; /* Remove the en-passant capture piece */
+        board->occupancy[side] ^= (1ULL << from) | (1ULL << to); /* Update the occupancy */
+        board->occupancy[!side] ^= ep_cap_pos;
         // Update zobrist key
         update_key_ep(board, piece, from, to, bitscan(ep_cap_pos), side ? pawn_b : pawn_w);
 
@@ -100,6 +142,8 @@ void make_move(Bitboard *board, move_t move, U64 *enpas_file, U64 *castling_righ
     else { /* Finally, a normal move... */
         board->pieces[piece] ^= (1ULL << from) | (1ULL << to); /* Move the piece to the correct square */
         if (move & MM_CAP) /* If this is a capture move */ board->pieces[cap_piece] ^= 1ULL << to; /* Remove captured piece from board */
+        board->occupancy[side] ^= (1ULL << from) | (1ULL << to); /* Update the occupancy */
+        if (move & MM_CAP) board->occupancy[!side] ^= 1ULL << to;
         // Update zobrist key
         update_key_move(board, piece, from, to, move & MM_CAP, cap_piece); /* look in zobrist_hash.c */
         // Update Piece-square Tables
@@ -107,11 +151,16 @@ void make_move(Bitboard *board, move_t move, U64 *enpas_file, U64 *castling_righ
         board->piece_square_eval += piece_square[piece][to]; /* Add to-square */
         if (move & MM_CAP) board->piece_square_eval -= piece_square[cap_piece][to]; /* Remove captured piece (if so) */
     }
+    board->occupied = board->occupancy[0] | board->occupancy[1];
+    board->mailbox[from] = NO_PIECE; /* Update the mailbox */
+    board->mailbox[to] = (move & MM_PRO) ? (side ? promoted : promoted + 6) : piece;
+    if (move & MM_EPC) board->mailbox[side ? to - 8 : to + 8] = NO_PIECE; /* The pawn captured en-passant */
+
     // Set en-passant file
     
     // Remove the old ep-file from the hash key
-    int old_ep = bitscan(*enpas_file & 255); /* Get the previous en-passant file */
-    if (*enpas_file) board->key ^= epf_hash[old_ep]; /* If there is an old ep file, remove it */
+    int old_ep = bitscan(undo->enpas & 255); /* Get the previous en-passant file */
+    if (undo->enpas) board->key ^= epf_hash[old_ep]; /* If there is an old ep file, remove it */
    
     if (move & MM_DPP) { /* If this is a double pawn push */
         board->enpas = files[to]; /* Set the en-passant file to the to move */
@@ -122,56 +171,70 @@ void make_move(Bitboard *board, move_t move, U64 *enpas_file, U64 *castling_righ
     else board->enpas = 0; /* Otherwise, no en-passant file */
 
     // Update attack tables
-    update_attack_table(board, piece); /* Update the attack table of the moved piece */
-    if (move & MM_CAP) update_attack_table(board, cap_piece); /* If this is a capture move, update the attack table of the captured piece */
+    if (!is_slider(piece)) update_attack_table(board, piece); /* Update the attack table of the moved piece */
+    if ((move & MM_CAP) && !is_slider(cap_piece)) update_attack_table(board, cap_piece); /* If this is a capture move, update the attack table of the captured piece */
     if (move & MM_EPC) update_attack_table(board, side ? pawn_b : pawn_w); /* If this is an ep capture move, update the opponent pawn attack table */
-    if (move & MM_PRO) update_attack_table(board, side ? promoted : promoted + 6); /* If this is a pawn promotion, update the promoted piece attack table */
-    update_sliding_piece_attacks(board); /* Update the sliding piece attack table, since that can be affected by moving blockers */
-
-    // Set castling rights
-    if (piece == rook_w && from == 7) { /* King side rook move */
-        if (board->castling_rights & WK_CASTLE) board->key ^= cr_hash[0]; /* Update hash */
-        board->castling_rights &= ~WK_CASTLE; /* If king-side rook is moved, disable king-side castling */
-    } if (piece == rook_w && from == 0) { /* Queen side rook move */
-        if (board->castling_rights & WQ_CASTLE) board->key ^= cr_hash[1]; /* Update hash */
-        board->castling_rights &= ~WQ_CASTLE; /* If queen-side rook is moved, disable queen-side castling */
-    } if (piece == king_w) { /* King move */
-        if (board->castling_rights & WK_CASTLE) board->key ^= cr_hash[0]; /* Update hash */
-        if (board->castling_rights & WQ_CASTLE) board->key ^= cr_hash[1]; /* Update hash */
-        board->castling_rights &= ~W_CASTLE; /* If king is moved, disable castling */
-    } // Ditto for black
-    if (piece == rook_b && from == 63) { /* King side rook move */
-        if (board->castling_rights & BK_CASTLE) board->key ^= cr_hash[3]; /* Update hash */
-        board->castling_rights &= ~BK_CASTLE; /* If king-side rook is moved, disable king-side castling */
-    } if (piece == rook_b && from == 56) { /* Queen side rook move */
-        if (board->castling_rights & BQ_CASTLE) board->key ^= cr_hash[4]; /* Update hash */
-        board->castling_rights &= ~BQ_CASTLE; /* If queen-side rook is moved, disable queen-side castling */
-    } if (piece == king_b) { /* King move */
-        if (board->castling_rights & BK_CASTLE) board->key ^= cr_hash[3]; /* Update hash */
-        if (board->castling_rights & BQ_CASTLE) board->key ^= cr_hash[4]; /* Update hash */
-        board->castling_rights &= ~B_CASTLE; /* If king is moved, disable castling */
+    if ((move & MM_PRO) && promoted == knight_w) update_attack_table(board, side ? knight_w : knight_b); /* If this is a knight promotion, update the knight attack table */
+    board->stale_sliders = 1; /* The sliding piece attack tables are updated when they are needed (see attack_table) */
+
+    // Set castling rights (only our own pieces can have moved)
+    if (side) {
+        if (piece == rook_w && from == 7) { /* King side rook move */
+            if (board->castling_rights & WK_CASTLE) board->key ^= cr_hash[0]; /* Update hash */
+            board->castling_rights &= ~WK_CASTLE; /* If king-side rook is moved, disable king-side castling */
+        } if (piece == rook_w && from == 0) { /* Queen side rook move */
+            if (board->castling_rights & WQ_CASTLE) board->key ^= cr_hash[1]; /* Update hash */
+            board->castling_rights &= ~WQ_CASTLE; /* If queen-side rook is moved, disable queen-side castling */
+        } if (piece == king_w) { /* King move */
+            if (board->castling_rights & WK_CASTLE) board->key ^= cr_hash[0]; /* Update hash */
+            if (board->castling_rights & WQ_CASTLE) board->key ^= cr_hash[1]; /* Update hash */
+            board->castling_rights &= ~W_CASTLE; /* If king is moved, disable castling */
+        }
+    } else { // Ditto for black
+        if (piece == rook_b && from == 63) { /* King side rook move */
+            if (board->castling_rights & BK_CASTLE) board->key ^= cr_hash[2]; /* Update hash */
+            board->castling_rights &= ~BK_CASTLE; /* If king-side rook is moved, disable king-side castling */
+        } if (piece == rook_b && from == 56) { /* Queen side rook move */
+            if (board->castling_rights & BQ_CASTLE) board->key ^= cr_hash[3]; /* Update hash */
+            board->castling_rights &= ~BQ_CASTLE; /* If queen-side rook is moved, disable queen-side castling */
+        } if (piece == king_b) { /* King move */
+            if (board->castling_rights & BK_CASTLE) board->key ^= cr_hash[2]; /* Update hash */
+            if (board->castling_rights & BQ_CASTLE) board->key ^= cr_hash[3]; /* Update hash */
+            board->castling_rights &= ~B_CASTLE; /* If king is moved, disable castling */
+        }
     }
     // Change side-to-move
-    board->side = !board->side; /* Toggle this */
+    board->side = !side; /* Toggle this */
     board->key ^= side_hash; /* Toggle side-to-move on zobrist key */
     board->moves++; /* Plus plus the move count */
 }
 
+void make_move(Bitboard *board, move_t move) {
+    /* Make a move, with the code specialized for the side to move */
+    if (board->side) make_move_side(board, move, 1);
+    else make_move_side(board, move, 0);
+}
 
-void unmake_move(Bitboard *board, move_t move, U64 *enpas_file, U64 *castling_rights, U64 *key, int *piece_square_eval) {
-    /* Unmakes the move on the board */
-    // Reset saved values
-    board->enpas = *enpas_file;
-    board->castling_rights = *castling_rights;
-    board->key = *key;
-    board->piece_square_eval = *piece_square_eval; 
-    // Since the xor operation is it's own inverse, we can just repeat the same steps we used for the make move function.
-
+SIDE_INLINE void unmake_move_side(Bitboard *board, move_t move, const int side) {
+    /* Unmakes the move on the board (side is the side that made it, see unmake_move) */
     // Change the side-to-move
-    board->side = !board->side; /* Toggle side-to-move */
-    int side = board->side; /* Why not */
+    board->side = side; /* Toggle side-to-move back */
     board->moves--; /* Minus Minus */
 
+    // Reset saved values
+    undo_t *undo = undo_record(board); /* Saved by make_move */
+    board->enpas = undo->enpas;
+    board->castling_rights = undo->castling_rights;
+    board->key = undo->key;
+    board->pawn_key = undo->pawn_key;
+    board->piece_square_eval = undo->piece_square_eval; 
+    memcpy(board->attack_tables, undo->attack_tables, sizeof(board->attack_tables)); /* No need to regenerate the attack tables */
+    board->stale_sliders = undo->stale_sliders;
+    board->occupancy[0] = undo->occupancy[0];
+    board->occupancy[1] = undo->occupancy[1];
+    board->occupied = undo->occupied;
+    // Since the xor operation is it's own inverse, we can just repeat the same steps we used for the make move function.
+
     // Handle castling moves
     if (move & MM_CAS) { /* If this is a castling move */
         /* Handle Castling */
@@ -182,10 +245,7 @@ void unmake_move(Bitboard *board, move_t move, U64 *enpas_file, U64 *castling_ri
             board->pieces[king_b] ^= (move & MM_CSD) ? CAS_KING_BQ : CAS_KING_BK; /* Move the king */
             board->pieces[rook_b] ^= (move & MM_CSD) ? CAS_ROOK_BQ : CAS_ROOK_BK; /* Move the rook */
         }
-      
-        // Update attack tables
-        update_attack_table(board, side ? king_w : king_b); /* Update king attack table */
-        update_sliding_piece_attacks(board); /* Update the sliding piece attack table, since that can be affected by moving blockers */ 
+        castle_mailbox(board, side, move & MM_CSD, 1);
         return;
     }
 
@@ -200,7 +260,7 @@ void unmake_move(Bitboard *board, move_t move, U64 *enpas_file, U64 *castling_ri
     // Pawn promotion Move
     if (move & MM_PRO) { /* If this is a pawn promotion move */
         board->pieces[piece] ^= 1ULL << from; /* Remove piece */
-        board->pieces[board->side ? promoted : promoted + 6] ^= 1ULL << to; /* Appear as promoted piece */
+        board->pieces[side ? promoted : promoted + 6] ^= 1ULL << to; /* Appear as promoted piece */
         if (move & MM_CAP) /* If this is a capture move */ board->pieces[cap_piece] ^= 1ULL << to; /* Remove captured piece from board */
     }
     // En-passant capture
@@ -214,13 +274,35 @@ void unmake_move(Bitboard *board, move_t move, U64 *enpas_file, U64 *castling_ri
         board->pieces[piece] ^= (1ULL << from) | (1ULL << to); /* Move the piece to the correct square */
         if (move & MM_CAP) /* If this is a capture move */ board->pieces[cap_piece] ^= 1ULL << to; /* Remove captured piece from board */
     }
-    
-    // Update attack tables
-    update_attack_table(board, piece); /* Update the attack table of the moved piece */
-    if (move & MM_CAP) update_attack_table(board, cap_piece); /* If this is a capture move, update the attack table of the captured piece */
-    if (move & MM_EPC) update_attack_table(board, side ? pawn_b : pawn_w); /* If this is an ep capture move, update the opponent pawn attack table */
-    if (move & MM_PRO) update_attack_table(board, side ? promoted : promoted + 6); /* If this is a pawn promotion, update the promoted piece attack table */
-    update_sliding_piece_attacks(board); /* Update the sliding piece attack table, since that can be affected by moving blockers */
-   
+    board->mailbox[from] = piece; /* Put the mailbox back */
+    board->mailbox[to] = (move & MM_CAP) ? cap_piece : NO_PIECE;
+    if (move & MM_EPC) board->mailbox[side ? to - 8 : to + 8] = side ? pawn_b : pawn_w;
     return;
 }
+
+void unmake_move(Bitboard *board, move_t move) {
+    /* Unmake a move, with the code specialized for the side that made it */
+    if (board->side) unmake_move_side(board, move, 0);
+    else unmake_move_side(board, move, 1);
+}
+
+void make_null_move(Bitboard *board) {
+    /* Pass the turn to the opponent without moving anything (used for null move pruning) */
+    undo_t *undo = undo_record(board); /* Only the en-passant file and key change */
+    undo->enpas = board->enpas; /* Save the en-passant file */
+    undo->key = board->key; /* Save the key */
+    if (board->enpas) board->key ^= epf_hash[bitscan(board->enpas & 255)]; /* Remove the en-passant file from the key */
+    board->enpas = 0; /* No en-passant capture after a null move */
+    board->side = !board->side; /* Toggle side-to-move */
+    board->key ^= side_hash; /* Toggle side-to-move on zobrist key */
+    board->moves++; /* Plus plus the move count */
+}
+
+void unmake_null_move(Bitboard *board) {
+    /* Undo a null move (Nothing on the board has moved, so the attack tables are still correct) */
+    board->side = !board->side; /* Toggle side-to-move */
+    board->moves--; /* Minus Minus */
+    undo_t *undo = undo_record(board);
+    board->enpas = undo->enpas;
+    board->key = undo->key;
+}
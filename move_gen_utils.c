@@ -10,7 +10,7 @@
 #include "lookup_tables.h"
 
 U64 colour_mask(Bitboard *board, int side) {
-    /* Returns a union of all the boards of a certian colour */
+    /* Returns a union of all the boards of a certian colour (computed from scratch, use board->occupancy instead when the board is set up) */
     if (side) { /* If the colour is white */
         return board->pieces[0] /* From 0 */
              | board->pieces[1]
@@ -28,10 +28,9 @@ U64 colour_mask(Bitboard *board, int side) {
     }
 }
 
-int get_captured_piece(Bitboard *board, U64 position, int side) {
-    /* Gets the id of a captured piece */
-    for (int piece_id = (side) ? 6 : 0; piece_id < (side) ? 12 : 6; piece_id++) { /* Loop through all the opponent pieces */
-        if (board->pieces[piece_id] & position) /* if the position has an opponent piece */ return piece_id; /* Break out of the loop and return the id */
-    }
-    return 12;
+U64 target_mask(U64 own_mask, U64 enemy_mask, int gen_type) {
+    /* Squares that pieces are allowed to move to for a generation type */
+    if (gen_type == gen_captures) return enemy_mask; /* Only captures */
+    if (gen_type == gen_quiets) return ~(own_mask | enemy_mask); /* Only empty squares */
+    return ~own_mask; /* Anything that isn't blocked */
 }
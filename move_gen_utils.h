@@ -2,5 +2,18 @@
 #ifndef MOVEGENUTILS_H
 #define MOVEGENUTILS_H
 U64 colour_mask(Bitboard *board, int side);
-int get_captured_piece(Bitboard *board, U64 position, int side);
+U64 target_mask(U64 own_mask, U64 enemy_mask, int gen_type);
+
+// Side specialization
+/* Code that branches on the side to move is written once, as a SIDE_INLINE function taking `const int side`.
+ * Calling it with a constant 1 or 0 gives a white and a black copy with the side folded in, so the branch is taken once per call instead of in the inner loops.
+*/
+#define SIDE_INLINE static inline __attribute__((always_inline))
+#define SIDE_SPECIALIZED_GENERATOR(name) /* Defines name_w, name_b and name (which picks one by the side to move) from name_side */ \
+    void name##_w(move_list_t *move_list, Bitboard *board, int gen_type) { name##_side(move_list, board, gen_type, 1); } \
+    void name##_b(move_list_t *move_list, Bitboard *board, int gen_type) { name##_side(move_list, board, gen_type, 0); } \
+    void name(move_list_t *move_list, Bitboard *board, int gen_type) { \
+        if (board->side) name##_w(move_list, board, gen_type); \
+        else name##_b(move_list, board, gen_type); \
+    }
 #endif
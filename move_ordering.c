@@ -1,11 +1,13 @@
 /* move_ordering.c
  * Orders moves using multiple heuristic methods.
- * Sorts them using selection sort
+ * Sorts them using selection sort, or picks them best first one at a time
+ * Staged move picker for the search
 */
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
 #include <time.h>
+#include <string.h>
 #include "bitboards.h"
 #include "bitboard_utils.h"
 #include "moves.h"
@@ -18,64 +20,71 @@
 #include "evaluation.h"
 #include "search.h" /* result_t typedef */
 #include "quiescence.h"
+#include "see.h"
+#include "legal_moves.h"
+#include "move_ordering.h"
 #define INF INT_MAX
 
 // Weights for each of the move ordering schemes (Deal with this later).
 
-void sort_moves(move_list_t *move_list, int scores[]);
+move_trace_t *move_trace = 0; /* Not recording */
 
-void order_moves(move_list_t *move_list, Bitboard *board, int use_hash_move, move_t hash_move) {
-    /* Order moves to be searched using heuristic methods, so that more branches are likely to be pruned.
+int score_move(Bitboard *board, move_t move, heuristics_t *heuristics, int *losing) {
+    /* Score a move using heuristic methods, so that more branches are likely to be pruned.
      * Ordering methods:
-     *  -> Move score from hash table (Not yet implemented).
-     *  -> For capture moves, most valuable victim, least valuable attacker.
+     *  -> Captures and promotions that don't lose material (by static exchange) first, by most valuable victim, least valuable attacker.
+     *  -> Captures that lose material last, by how much they lose.
      *  -> Promoted piece value.
-     *  -> Recapured by pawn (penalty).
-     *  Think about the following ideas.
-     *  -> Killer moves? (not yet implemented)
-     *  -> History heuristic? (not yet implemented)
+     *  -> Quiet move to a square attacked by a pawn (penalty).
+     *  -> History heuristic for quiet moves (if heuristics is given).
+     * Killer moves and countermoves are tried by the move picker before the rest of the quiet moves.
+     * If losing is given, it is set to whether the move loses material by static exchange, so that nobody has to do the exchange again.
      */
-
-    int move_scores[256]; /* List containing all the move scores */
-    // Use following values in the loop
-    int score; /* Use in loop */
-    int to;
-    move_t move; /* Current move */
-    int piece;
+    int score = 0;
+    int piece = (move & MM_PIECE) >> MS_PIECE; /* Get the piece to move */
+    int to = (move & MM_TO) >> MS_TO; /* Square to move to */
     int cap_piece;
     int promoted;
+    int exchange = 0; /* Static exchange evaluation */
 
-    for (int index = 0; index < move_list->count; index++) { /* Loop through all of the moves */
-        // Give each move a score.
-        move = move_list->moves[index]; /* Get the current move */
-        score = 0; /* Reset score */
-        piece = (move & MM_PIECE) >> MS_PIECE; /* Get the piece to move */
-        to = (move & MM_TO) >> MS_TO; /* Square to move to */
-        
-        // Check if this is the hash move
-        if (use_hash_move) { /* If we have to use the tp table */
-            if (move == hash_move) { /* If this is the same as the hash move */
-                score = INF; /* Hash Move - Best Move! ;-) */
-                move_scores[index] = score; /* Set the move score */
-                continue; /* Where were we... */
-            }
-        }
-
-        if (move & MM_CAP) { /* A Capture move */
+    if (move & (MM_CAP | MM_EPC | MM_PRO)) { /* A capture or promotion */
+        exchange = capture_exchange(board, move); /* Only done in full when the capture could lose material */
+        if (exchange < 0) score += exchange; /* Loses material, try it late */
+        else {
             cap_piece = (move & MM_EAT) >> MS_EAT; /* Get the captured piece */
-            score += materials[cap_piece] - materials[piece]; /* Most valuable victim, least valuable aggressor */
+            if (move & MM_CAP) score += materials[cap_piece] - materials[piece]; /* Most valuable victim, least valuable aggressor */
+            score += GOOD_CAPTURE;
         }
+    }
 
-        if (move & MM_PRO) { /* A promotion move! */
-            promoted = (move & MM_PPP) >> MS_PPP; /* Get promoted piece type */
-            score += materials[promoted]; /* Give the promoted piece a score */
-        }
+    if (move & MM_PRO) { /* A promotion move! */
+        promoted = (move & MM_PPP) >> MS_PPP; /* Get promoted piece type */
+        score += materials[promoted]; /* Give the promoted piece a score */
+    }
 
-        if ((1ULL << to) & board->attack_tables[board->side ? pawn_b : pawn_w]) { /* If moving to a square that is attacked by an enemy pawn */
-            score -= materials[piece]; /* Subtract the material of the piece, since it will probably be captured on the next move */
-        }
+    if (heuristics && !(move & MM_CAP)) { /* A quiet move */
+        score += heuristics->history[board->side][move & MM_FROM][to]; /* How often this move has caused cutoffs before */
+    }
 
-        move_scores[index] = score; /* Set the move score */
+    if (!(move & (MM_CAP | MM_EPC | MM_PRO)) && (1ULL << to) & board->attack_tables[board->side ? pawn_b : pawn_w]) { /* If a quiet move goes to a square that is attacked by an enemy pawn (the exchange covers captures) */
+        score -= materials[piece]; /* Subtract the material of the piece, since it will probably be captured on the next move */
+    }
+
+    if (losing) *losing = exchange < 0;
+    return score;
+}
+
+void order_moves(move_list_t *move_list, Bitboard *board, int use_hash_move, move_t hash_move, heuristics_t *heuristics) {
+    /* Order a whole move list by score (hash move first), using a full selection sort.
+     * The search uses score_moves and pick_next_best instead, which only sort as much as is used.
+     */
+    int move_scores[256]; /* List containing all the move scores */
+    move_t move; /* Current move */
+
+    for (int index = 0; index < move_list->count; index++) { /* Loop through all of the moves */
+        move = move_list->moves[index]; /* Get the current move */
+        if (use_hash_move && move == hash_move) move_scores[index] = INF; /* Hash Move - Best Move! ;-) */
+        else move_scores[index] = score_move(board, move, heuristics, 0); /* Set the move score */
     }
 
     sort_moves(move_list, move_scores); /* Sort the moves */
@@ -103,3 +112,175 @@ void sort_moves(move_list_t *move_list, int scores[]) {
         }
     }
 }
+
+void score_moves(move_list_t *move_list, scored_list_t *scored, Bitboard *board, heuristics_t *heuristics) {
+    /* Score a generated move list into a scored list, ready to be picked from */
+    for (int index = 0; index < move_list->count; index++) {
+        scored->moves[index].move = move_list->moves[index];
+        scored->moves[index].score = score_move(board, move_list->moves[index], heuristics, &scored->moves[index].losing); /* The exchange is kept, so picking the move doesn't need it again */
+    }
+    scored->count = move_list->count;
+    scored->next = 0;
+    scored->trace = -1;
+    if (move_trace && move_trace->list_count < move_trace->max_lists && move_trace->move_count + scored->count <= move_trace->max_moves) { /* Recording, and there is room left */
+        move_trace->lists[move_trace->list_count] = (traced_list_t){move_trace->move_count, scored->count, 0};
+        memcpy(move_trace->moves + move_trace->move_count, scored->moves, scored->count * sizeof(scored_move_t));
+        move_trace->move_count += scored->count;
+        scored->trace = move_trace->list_count++;
+    }
+}
+
+scored_move_t *pick_next_best(scored_list_t *list) {
+    /* Hand out the best move not picked yet (with its score), or 0 if there are none left.
+     * Each pick is one pass of a selection sort, so only as much of the list is sorted as is used (most cutoffs come from the first move or two).
+    */
+    if (list->next >= list->count) return 0; /* Nothing left */
+    scored_move_t *first = &list->moves[list->next], *best = first, swap;
+    for (scored_move_t *entry = first + 1; entry < list->moves + list->count; entry++) /* Find the best of the rest */
+        if (entry->score > best->score) best = entry;
+    swap = *first; /* Put it at the front */
+    *first = *best;
+    *best = swap;
+    list->next++;
+    if (list->trace >= 0) move_trace->lists[list->trace].picked++; /* Record how far into the list the search got */
+    return first;
+}
+
+int capture_exchange(Bitboard *board, move_t move) {
+    /* Static exchange of a capture or promotion, or 0 when it can't lose material.
+     * Taking a piece worth at least as much as the capturing piece can't lose anything, so the exchange is skipped for those.
+    */
+    int piece = (move & MM_PIECE) >> MS_PIECE;
+    if ((move & MM_CAP) && !(move & MM_PRO) && materials[(move & MM_EAT) >> MS_EAT] >= materials[piece]) return 0; /* Nothing to lose */
+    return see(board, move);
+}
+
+int losing_capture(Bitboard *board, move_t move) {
+    /* Check if a capture or promotion loses material by static exchange */
+    return capture_exchange(board, move) < 0;
+}
+
+void init_move_picker(move_picker_t *picker, Bitboard *board, move_t hash_move, heuristics_t *heuristics, int ply, move_t last_move) {
+    /* Set up a move picker for a position (heuristics can be 0) */
+    picker->board = board;
+    picker->stage = stage_hash; /* Start with the hash move */
+    picker->hash_move = hash_move;
+    picker->heuristics = heuristics;
+    picker->killers[0] = heuristics ? heuristics->killers[ply][0] : 0;
+    picker->killers[1] = heuristics ? heuristics->killers[ply][1] : 0;
+    picker->countermove = (heuristics && last_move && !(last_move & MM_CAS)) ? heuristics->countermoves[(last_move & MM_PIECE) >> MS_PIECE][(last_move & MM_TO) >> MS_TO] : 0; /* No countermove after a null move or castling */
+    picker->index = 0;
+    picker->moves.count = 0;
+    picker->bad_captures.count = picker->bad_captures.next = 0;
+    picker->bad_captures.trace = -1; /* Copied from the captures, already recorded */
+    get_legal_info(board, &picker->legal); /* Once for all the moves */
+}
+
+move_t next_move(move_picker_t *picker) {
+    /* Get the next legal move to search, or 0 if there are no moves left.
+     * Stages:
+     *  -> Hash move (after a cheap pseudo-legality check, before generating anything).
+     *  -> Captures and promotions that don't lose material, best first.
+     *  -> Killer moves (quiet moves that caused a cutoff at the same ply), then the countermove to the previous move.
+     *  -> The rest of the quiet moves, best first.
+     *  -> Captures that lose material by static exchange.
+     * The hash move, killers and countermove are checked for legality on their own, the rest are generated legal.
+    */
+    Bitboard *board = picker->board;
+    move_t move;
+    scored_move_t *picked; /* Move from a scored list */
+    move_list_t generated; /* Moves of the stage, before they are scored */
+    switch (picker->stage) { /* Each stage falls through to the next one when it runs out of moves */
+        case stage_hash:
+            picker->stage = stage_gen_captures;
+            if (is_pseudo_legal(board, picker->hash_move) && legal_move(board, picker->hash_move, &picker->legal)) return picker->hash_move; /* Hash Move - Best Move ! */
+            picker->hash_move = 0; /* Not a valid move here, don't skip it later */
+        case stage_gen_captures:
+            generated.count = 0;
+            generate_legal_moves_type(board, &generated, gen_captures, &picker->legal); /* Generate captures */
+            score_moves(&generated, &picker->moves, board, 0); /* Score them, they are sorted as they are picked */
+            picker->stage = stage_captures;
+        case stage_captures:
+            while ((picked = pick_next_best(&picker->moves))) { /* Loop through the captures, best first */
+                move = picked->move;
+                if (move == picker->hash_move) continue; /* Already tried the hash move */
+                if (picked->losing) { /* The best one left loses material, so they all do */
+                    picker->moves.next--; /* Put it back */
+                    for (int index = picker->moves.next; index < picker->moves.count; index++) /* Put them off until after the quiet moves */
+                        if (picker->moves.moves[index].move != picker->hash_move) picker->bad_captures.moves[picker->bad_captures.count++] = picker->moves.moves[index];
+                    break;
+                }
+                return move;
+            }
+            picker->index = 0;
+            picker->stage = stage_killers;
+        case stage_killers:
+            while (picker->index < 2) { /* Loop through the killers */
+                move = picker->killers[picker->index++]; /* Next killer */
+                if (move && move != picker->hash_move && !(move & (MM_CAP | MM_EPC | MM_PRO)) && is_pseudo_legal(board, move) && legal_move(board, move, &picker->legal)) return move; /* Quiet and possible here */
+                picker->killers[picker->index - 1] = 0; /* Not tried, don't skip it later */
+            }
+            picker->stage = stage_countermove;
+        case stage_countermove:
+            picker->stage = stage_gen_quiets;
+            move = picker->countermove; /* Refutation of the previous move */
+            if (move && move != picker->hash_move && move != picker->killers[0] && move != picker->killers[1] && !(move & (MM_CAP | MM_EPC | MM_PRO)) && is_pseudo_legal(board, move) && legal_move(board, move, &picker->legal)) return move; /* Quiet and possible here */
+            picker->countermove = 0; /* Not tried, don't skip it later */
+        case stage_gen_quiets:
+            generated.count = 0;
+            generate_legal_moves_type(board, &generated, gen_quiets, &picker->legal); /* Generate the quiet moves */
+            score_moves(&generated, &picker->moves, board, picker->heuristics); /* Score them by history */
+            picker->stage = stage_quiets;
+        case stage_quiets:
+            while ((picked = pick_next_best(&picker->moves))) /* Loop through the quiet moves, best first */
+                if (picked->move != picker->hash_move && picked->move != picker->killers[0] && picked->move != picker->killers[1] && picked->move != picker->countermove) return picked->move; /* Don't try a move twice */
+            picker->stage = stage_bad_captures;
+        case stage_bad_captures:
+            if ((picked = pick_next_best(&picker->bad_captures))) return picked->move; /* Next losing capture, least bad first */
+            picker->stage = stage_done;
+        default:
+            return 0; /* No moves left */
+    }
+}
+
+void clear_heuristics(heuristics_t *heuristics) {
+    /* Forget everything */
+    memset(heuristics, 0, sizeof(heuristics_t));
+}
+
+void age_heuristics(heuristics_t *heuristics) {
+    /* Called between iterations, so that what was learnt in older iterations slowly loses weight */
+    for (int side = 0; side < 2; side++)
+        for (int from = 0; from < 64; from++)
+            for (int to = 0; to < 64; to++)
+                heuristics->history[side][from][to] /= 2; /* Halve all the history scores */
+}
+
+void update_history(int *entry, int bonus) {
+    /* Add a bonus (or penalty) to a history entry, using gravity so that it can never go past HISTORY_MAX */
+    int magnitude = bonus < 0 ? -bonus : bonus;
+    *entry += bonus - (*entry * magnitude) / HISTORY_MAX; /* Entries close to the limit move less */
+}
+
+void update_heuristics(heuristics_t *heuristics, Bitboard *board, move_t move, int depth, int ply, move_t last_move, move_t *quiets_tried, int quiet_count) {
+    /* Learn from a quiet move that caused a beta cutoff.
+     *  -> It becomes a killer move at this ply.
+     *  -> Its history score goes up, and the quiet moves tried before it (which didn't cause a cutoff) go down.
+     *  -> It becomes the countermove for the previous move.
+    */
+    int side = board->side;
+    int bonus = depth * depth; /* Cutoffs near the root are worth more */
+    if (bonus > HISTORY_MAX / 4) bonus = HISTORY_MAX / 4;
+    // Killer moves
+    if (heuristics->killers[ply][0] != move) { /* Don't fill both slots with the same move */
+        heuristics->killers[ply][1] = heuristics->killers[ply][0]; /* Shift the old killer down */
+        heuristics->killers[ply][0] = move;
+    }
+    // History
+    update_history(&heuristics->history[side][move & MM_FROM][(move & MM_TO) >> MS_TO], bonus);
+    for (int index = 0; index < quiet_count; index++) /* Quiet moves that failed to cut off */
+        if (quiets_tried[index] != move) update_history(&heuristics->history[side][quiets_tried[index] & MM_FROM][(quiets_tried[index] & MM_TO) >> MS_TO], -bonus);
+    // Countermove
+    if (last_move && !(last_move & MM_CAS)) /* Not after a null move or castling */
+        heuristics->countermoves[(last_move & MM_PIECE) >> MS_PIECE][(last_move & MM_TO) >> MS_TO] = move;
+}
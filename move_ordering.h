@@ -1,6 +1,86 @@
 /* Header file for move_ordering.c */
 #ifndef MOVEORDERING_H
 #define MOVEORDERING_H
-void order_moves(move_list_t *move_list, Bitboard *board, int use_hash_move, move_t hash_move);
+#define MAX_PLY 128 /* Maximum search depth */
+#define HISTORY_MAX 4096 /* History scores stay between -HISTORY_MAX and HISTORY_MAX */
+#define GOOD_CAPTURE 10000 /* Ordering bonus for captures that don't lose material */
+
+typedef struct heuristics_t {
+    /* Move ordering heuristics learnt during the search (each search thread has its own) */
+    move_t killers[MAX_PLY][2]; /* Two quiet moves that caused a cutoff at each ply */
+    int history[2][64][64]; /* Butterfly history, by side, from square and to square */
+    move_t countermoves[12][64]; /* Quiet move that refuted the previous move, by previous piece and to square */
+} heuristics_t;
+
+typedef struct scored_move_t {
+    /* A move and its ordering score, kept side by side */
+    move_t move;
+    int score;
+    int losing; /* Loses material by static exchange (only captures and promotions can) */
+} scored_move_t;
+
+typedef struct scored_list_t {
+    /* Scored moves, handed out best first by pick_next_best */
+    scored_move_t moves[256]; /* Large enough to fit all */
+    int count; /* Number of moves in list */
+    int next; /* Moves before this have been picked already */
+    int trace; /* Index of this list in move_trace (-1 if not recorded) */
+} scored_list_t;
+
+typedef struct traced_list_t {
+    /* A scored list recorded during a search */
+    int start; /* First move in move_trace->moves */
+    int count; /* Number of moves */
+    int picked; /* Moves picked before the search moved on */
+} traced_list_t;
+
+typedef struct move_trace_t {
+    /* Scored lists from a real search, and how much of each was used (for the ordering benchmark) */
+    scored_move_t *moves; /* All the lists' moves, back to back */
+    int move_count, max_moves;
+    traced_list_t *lists;
+    int list_count, max_lists;
+} move_trace_t;
+
+extern move_trace_t *move_trace; /* Record scored lists here when set (single search thread only) */
+
+// Move picker stages
+enum {
+    stage_hash, /* Try the hash move */
+    stage_gen_captures, /* Generate and order captures */
+    stage_captures, /* Try captures */
+    stage_killers, /* Try killer moves */
+    stage_countermove, /* Try the countermove */
+    stage_gen_quiets, /* Generate and order quiet moves */
+    stage_quiets, /* Try quiet moves */
+    stage_bad_captures, /* Try captures that lose material */
+    stage_done /* No moves left */
+};
+
+typedef struct move_picker_t {
+    /* Hands out the moves of a position one stage at a time, so that no time is wasted generating moves if an early move causes a cutoff */
+    Bitboard *board; /* The position */
+    int stage; /* Current stage */
+    move_t hash_move; /* Move from the tp table (0 if none) */
+    move_t killers[2]; /* Killer moves (0 if none) */
+    move_t countermove; /* Refutation of the previous move (0 if none) */
+    heuristics_t *heuristics; /* Used to order the quiet moves (0 if none) */
+    int index; /* Next killer to try */
+    scored_list_t moves; /* Moves generated for the current stage */
+    scored_list_t bad_captures; /* Captures put off until after the quiet moves */
+    legal_info_t legal; /* Checkers and pins, so that only legal moves are handed out */
+} move_picker_t;
+
+void init_move_picker(move_picker_t *picker, Bitboard *board, move_t hash_move, heuristics_t *heuristics, int ply, move_t last_move);
+move_t next_move(move_picker_t *picker);
+void clear_heuristics(heuristics_t *heuristics);
+void age_heuristics(heuristics_t *heuristics);
+void update_heuristics(heuristics_t *heuristics, Bitboard *board, move_t move, int depth, int ply, move_t last_move, move_t *quiets_tried, int quiet_count);
+void order_moves(move_list_t *move_list, Bitboard *board, int use_hash_move, move_t hash_move, heuristics_t *heuristics);
 void sort_moves(move_list_t *move_list, int scores[]);
+int score_move(Bitboard *board, move_t move, heuristics_t *heuristics, int *losing);
+void score_moves(move_list_t *move_list, scored_list_t *scored, Bitboard *board, heuristics_t *heuristics);
+scored_move_t *pick_next_best(scored_list_t *list);
+int capture_exchange(Bitboard *board, move_t move);
+int losing_capture(Bitboard *board, move_t move);
 #endif
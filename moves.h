@@ -36,6 +36,13 @@ typedef unsigned int move_t; /* a move is basically an unsigned int, with parts
 // Flags
 #define MS_PPP 30 /* Bitshift for promote to piece flag */
 
+// Move generation types
+enum {
+    gen_all, /* All pseudo-legal moves */
+    gen_captures, /* Captures, en-passant captures and promotions */
+    gen_quiets /* Everything else */
+};
+
 // Move list system
 typedef struct move_list_t{
     move_t moves[256]; /* An array of moves, large enough to fit all */
@@ -0,0 +1,102 @@
+/* pawn_hash.c
+ * Pawn structure evaluation, cached by pawn zobrist key.
+ * The pawns move rarely compared to the other pieces, so almost every lookup finds the formation already evaluated.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "bitboards.h"
+#include "bitboard_utils.h"
+#include "lookup_tables.h"
+#include "moves.h"
+#include "search.h"
+#include "pawn_hash.h"
+
+#define DOUBLED_PAWN 15 /* Penalty for each pawn with another pawn of its side in front of it */
+#define ISOLATED_PAWN 15 /* Penalty for a pawn with no pawns of its side on the adjacent files */
+#define BACKWARD_PAWN 10 /* Penalty for a pawn that can't be defended by pawns and can't advance safely */
+static const int passed_pawn[8] = {0, 5, 10, 20, 35, 60, 100, 0}; /* Bonus for a passed pawn by rank (from its own side) */
+
+#define NOT_A_FILE 0xfefefefefefefefeULL
+#define NOT_H_FILE 0x7f7f7f7f7f7f7f7fULL
+
+static pawn_entry_t *pawn_tables[MAX_THREADS]; /* One table per search thread id, kept between searches (helper threads are new every search) */
+__thread pawn_entry_t *pawn_table = 0; /* The current thread's table, so there are no races */
+__thread long long pawn_probes = 0; /* Pawn table lookups by the current thread */
+__thread long long pawn_hits = 0; /* Lookups that found the formation */
+
+U64 north_fill(U64 set) {
+    /* Smear every bit up to the 8th rank */
+    set |= set << 8;
+    set |= set << 16;
+    set |= set << 32;
+    return set;
+}
+
+U64 south_fill(U64 set) {
+    /* Smear every bit down to the 1st rank */
+    set |= set >> 8;
+    set |= set >> 16;
+    set |= set >> 32;
+    return set;
+}
+
+U64 adjacent_files(U64 set) {
+    /* The files next to the given set */
+    return ((set << 1) & NOT_A_FILE) | ((set >> 1) & NOT_H_FILE);
+}
+
+int evaluate_pawns(U64 own, U64 enemy, int side, pawn_entry_t *entry) {
+    /* Score the pawn structure of one side, and fill in its passed pawns and attack span */
+    int score = 0;
+    U64 front_span = side ? north_fill(own << 8) : south_fill(own >> 8); /* Squares in front of the pawns */
+    U64 enemy_front_span = side ? south_fill(enemy >> 8) : north_fill(enemy << 8);
+    U64 enemy_attacks = side ? (((enemy >> 9) & NOT_H_FILE) | ((enemy >> 7) & NOT_A_FILE)) : (((enemy << 7) & NOT_H_FILE) | ((enemy << 9) & NOT_A_FILE));
+    U64 blocked = enemy_front_span | adjacent_files(enemy_front_span); /* Squares where a pawn is not passed */
+    U64 advanced = front_span | own; /* Squares the pawns stand on or could advance to */
+    entry->attack_spans[side] = side ? (((advanced << 7) & NOT_H_FILE) | ((advanced << 9) & NOT_A_FILE)) : (((advanced >> 9) & NOT_H_FILE) | ((advanced >> 7) & NOT_A_FILE));
+    entry->passed[side] = 0;
+
+    U64 pawns = own;
+    while (pawns) { /* Loop through the pawns */
+        U64 position = pawns & -pawns; /* Isolate LSB */
+        int square = bitscan(position);
+        U64 file = files[square];
+        U64 neighbours = adjacent_files(file) & own; /* Pawns on the adjacent files */
+        if (front_span & position) score -= DOUBLED_PAWN; /* Another pawn of ours is behind this one on the same file */
+        if (!neighbours) score -= ISOLATED_PAWN;
+        else if (!(neighbours & (side ? south_fill(ranks[square]) : north_fill(ranks[square]))) /* No pawn beside or behind it can defend it */
+                 && ((side ? position << 8 : position >> 8) & enemy_attacks)) /* And an enemy pawn stops it from advancing */
+            score -= BACKWARD_PAWN;
+        if (!(position & blocked)) { /* No enemy pawn in front, or on the adjacent files in front */
+            entry->passed[side] |= position;
+            score += passed_pawn[side ? square / 8 : 7 - square / 8];
+        }
+        pawns ^= position; /* Reset LSB */
+    }
+    return score;
+}
+
+void use_pawn_table(int id) {
+    /* Give the current thread the pawn table of search thread id, allocating it the first time */
+    if (!pawn_tables[id]) {
+        pawn_tables[id] = calloc(PAWN_TABLE_SIZE, sizeof(pawn_entry_t)); /* A zeroed entry only matches boards with no pawns, which it scores right */
+        if (!pawn_tables[id]) {
+            fprintf(stderr, "Could not allocate a pawn hash table\n");
+            exit(1);
+        }
+    }
+    pawn_table = pawn_tables[id];
+}
+
+pawn_entry_t *probe_pawn_table(Bitboard *board) {
+    /* Get the pawn structure evaluation of a board, evaluating it only if it isn't in the table already */
+    pawn_entry_t *entry = &pawn_table[board->pawn_key & (PAWN_TABLE_SIZE - 1)];
+    pawn_probes++;
+    if (entry->key == board->pawn_key) { /* Found it (a zeroed entry is right for a board with no pawns, whose key is 0) */
+        pawn_hits++;
+        return entry;
+    }
+    entry->key = board->pawn_key;
+    entry->score = evaluate_pawns(board->pieces[pawn_w], board->pieces[pawn_b], 1, entry) - evaluate_pawns(board->pieces[pawn_b], board->pieces[pawn_w], 0, entry);
+    return entry;
+}
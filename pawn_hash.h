@@ -0,0 +1,18 @@
+/* Header file for pawn_hash.c */
+#ifndef PAWNHASH_H
+#define PAWNHASH_H
+#define PAWN_TABLE_SIZE 65536 /* Entries in each thread's pawn hash table (a power of 2) */
+
+typedef struct pawn_entry_t {
+    /* Pawn structure evaluation of one pawn formation */
+    U64 key; /* Pawn zobrist key */
+    int score; /* Pawn structure score for white (minus black's) */
+    U64 passed[2]; /* Passed pawns, by side (0 = black, 1 = white) */
+    U64 attack_spans[2]; /* Squares the pawns of each side attack now or could attack by advancing */
+} pawn_entry_t;
+
+void use_pawn_table(int id);
+pawn_entry_t *probe_pawn_table(Bitboard *board);
+extern __thread long long pawn_probes;
+extern __thread long long pawn_hits;
+#endif
@@ -1,5 +1,7 @@
 /* pawn_moves.c
  * Contains function to generate pseudo-legal pawn moves
+ * All the pawns are moved at once with bitboard shifts, one pass per kind of move.
+ * Every target square's pawn is then a constant offset behind it.
 */
 
 #include <stdio.h>
@@ -9,100 +11,61 @@
 #include "move_utils.h"
 #include "lookup_tables.h"
 #include "move_gen_utils.h"
+#include "pawn_moves.h"
 
-void add_pawn_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int pawn_index, U64 promotion_check, U64 enpas_check, U64 encap_check, U64 enemy_mask); /* Forward decleration */
+SIDE_INLINE void add_pawn_set(move_list_t *move_list, Bitboard *board, U64 targets, int offset, move_t flags, const int side); /* Forward decleration */
 
-void generate_pawn_moves(move_list_t *move_list, Bitboard *board) {
+#define pawn_shift(pawns, offset) ((offset) > 0 ? (pawns) << (offset) : (pawns) >> -(offset)) /* Shift a bitboard by a signed amount of squares */
+
+SIDE_INLINE void generate_pawn_moves_side(move_list_t *move_list, Bitboard *board, int gen_type, const int side) {
     /* Generates all pawn moves from a position, and adds them to move list */
     // Masks
-    int side = board->side; /* The side to move */
-    U64 own_mask = colour_mask(board, side); /* Generate colour mask for own side */
-    U64 enemy_mask = colour_mask(board, !side); /* Generate colour mask for enemy side */
-    // Declare for loop.
-    U64 pawns = (side) ? board->pieces[pawn_w] : board->pieces[pawn_b]; /* Get the pawn bitboard for the respective side */
-    U64 position = 0; /* Current pawn */
-    U64 move_set = 0; /* Pawn moves for current pawn */
-    int pawn_index; /* Index of pawn */
-    // Check for next move.
-    U64 double_push; /* Double pawn push check */
-    U64 promotion_check; /* Check if pawn can be promoted */
-    U64 block_check; /* Single push check (used for checking if double push is possible */
-    U64 enpas_move; /* Check for an en-passant capture */
-    // Main generation loop
-    while (pawns) { /* Loop through every pawn */
-        position = pawns & -pawns; /* Get next pawn (Isolate LSB) */
-        pawn_index = bitscan(position); /* Get index of pawn bit */
-        // Generate move set
-        move_set = (side) ? pawn_attacks_w[pawn_index] : pawn_attacks_b[pawn_index]; /* Lookup pawn capture moves */
-        move_set &= enemy_mask; /* Remove non-capture moves from lookup */
-        // Pawn pushes.
-        if (side) { /* for white */
-            block_check = (position << 8) /* move pawn up */ & ~(enemy_mask | own_mask) /* If not blocked */;
-            double_push = (block_check) /* If not blocked */ ? ((position << 16) /* Shift up */ & ranks[24] /* Check for 4'th rank */) /* Check for blockers */ & ~(enemy_mask | own_mask) : 0; /* Add double pawn pushing */
-            move_set |= block_check | double_push; /* Add them to move set */
-        } else { /* For black pieces */
-            block_check = (position >> 8) /* move pawn up */ & ~(enemy_mask | own_mask) /* If not blocked */;
-            double_push = (block_check) /* If not blocked */ ? ((position >> 16) /* Shift up */ & ranks[32] /* Check for 5'th rank */) /* Check for blockers */ & ~(enemy_mask | own_mask) : 0; /* Add double pawn pushing */
-            move_set |= block_check | double_push; /* Add them to move set */
-        }
-        // Check for en passant
-        enpas_move = (side) ? pawn_attacks_w[pawn_index] : pawn_attacks_b[pawn_index]; /* Lookup pawn capture moves */
-        enpas_move &= board->enpas; /* Check if the move is an en passant move */
-        if (!side) enpas_move &= ranks[16]; /* Rank check */
-        else enpas_move &= ranks[40]; /* Ditto */
-        move_set |= enpas_move; /* Add en-passant captures to move list */
-        // Check for promotion
-        promotion_check = (side) ? move_set & ranks[56] : move_set & ranks[0]; /* Check if promotion is possible */
-        // Add all the moves to the move list
-        add_pawn_moves(move_set, board, move_list, pawn_index, promotion_check, double_push, enpas_move, enemy_mask); /* Add all the pawn moves to the move list */
-        // Reset LSB
-        pawns ^= position; /* Reset the LSB (remove the pawn from the pawns list */
+    U64 pawns = board->pieces[(side) ? pawn_w : pawn_b]; /* Get the pawn bitboard for the respective side */
+    U64 empty = ~board->occupied; /* Squares pawns can be pushed to */
+    U64 enemy_mask = board->occupancy[!side]; /* Squares pawns can capture on */
+    U64 promotion_rank = ranks[(side) ? 56 : 0]; /* Last rank */
+    U64 enpas_target = board->enpas & ranks[(side) ? 40 : 16]; /* En passant square, if there is one */
+    int up = (side) ? 8 : -8; /* Offset of a push */
+    // Move every pawn at once
+    U64 pushes = pawn_shift(pawns, up) & empty; /* Single pushes */
+    U64 double_pushes = pawn_shift(pushes, up) & empty & ranks[(side) ? 24 : 32]; /* Double pushes, from pawns that could single push to the 3rd (6th) rank */
+    U64 left = pawn_shift(pawns & ~files[0], up - 1); /* Squares attacked towards the a-file */
+    U64 right = pawn_shift(pawns & ~files[7], up + 1); /* Squares attacked towards the h-file */
+    // Captures, en-passant captures and promotions
+    if (gen_type != gen_quiets) {
+        add_pawn_set(move_list, board, left & enemy_mask & ~promotion_rank, up - 1, MM_CAP, side);
+        add_pawn_set(move_list, board, right & enemy_mask & ~promotion_rank, up + 1, MM_CAP, side);
+        add_pawn_set(move_list, board, left & enemy_mask & promotion_rank, up - 1, MM_CAP | MM_PRO, side);
+        add_pawn_set(move_list, board, right & enemy_mask & promotion_rank, up + 1, MM_CAP | MM_PRO, side);
+        add_pawn_set(move_list, board, pushes & promotion_rank, up, MM_PRO, side);
+        add_pawn_set(move_list, board, left & enpas_target, up - 1, MM_EPC, side); /* The captured pawn isn't on the target square, so no capture flag */
+        add_pawn_set(move_list, board, right & enpas_target, up + 1, MM_EPC, side);
+    }
+    // Quiet pushes
+    if (gen_type != gen_captures) {
+        add_pawn_set(move_list, board, pushes & ~promotion_rank, up, 0, side);
+        add_pawn_set(move_list, board, double_pushes, 2 * up, MM_DPP, side);
     }
 }
 
-void add_pawn_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int pawn_index, U64 promotion_check, U64 enpas_check, U64 encap_check, U64 enemy_mask) {
-    /* Add pawn moves to the move list from a move bitboard */
-    int side = board->side; /* Makes code writing easier */
-    // Declare for loop
-    U64 position;
-    U64 cap_flag; /* Check if move is a capture */
-    int pos_index;
-    int cap_piece; /* Captured piece (if any) */
+SIDE_INLINE void add_pawn_set(move_list_t *move_list, Bitboard *board, U64 targets, int offset, move_t flags, const int side) {
+    /* Add a move to every target square, from the pawn `offset` squares behind it */
+    int piece = (side) ? pawn_w : pawn_b; /* Piece type */
     move_t move; /* Current move */
-    move_t rook_pro, knight_pro, bishop_pro, queen_pro; /* Use for promotion */
-    while (move_set) { /* Loop through the moves */
-        position = move_set & -move_set; /* Get next move (Isolate lsb) */
-        pos_index = bitscan(position); /* Get the index of the position */
-        // Create basic move
-        cap_flag = position & enemy_mask; /* Check if move is a capture */
-        if (cap_flag) cap_piece = get_captured_piece(board, position, side); /* If this is a capture, check which piece is being captured */
-        // Create move and add move
-        move = set_move(pawn_index /* from */, pos_index /* to */, (side) ? pawn_w : pawn_b /* piece type */,(cap_flag) ? cap_piece : 0 /* captured piece id */); /* Create a new move code */
-        if (cap_flag) move |= MM_CAP; /* If this is a capture move, add the capture flag to the move */
-        // Enpas Capture
-        if (position & encap_check) move |= MM_EPC; /* Make this an en passant capture move if it is one */
-        // Double pawn push
-        if (position & enpas_check) move |= MM_DPP; /* Make this a double pawn push if it is one */
-        // Add promotion moves.
-        if (promotion_check) {
-            // Create a promotion move
-            rook_pro = move; /* Set the rook promotion move to the same as this move */
-            rook_pro |= MM_PRO; /* Make this a promotion move */
-            // Set all other promotions
-            knight_pro = bishop_pro = queen_pro = rook_pro; /* Set all the other promotion moves */
-            // Set the promotion types
-            /* rook promotion is of a type 0 */
-            knight_pro |= knight_w << MS_PPP;
-            bishop_pro |= bishop_w << MS_PPP;
-            queen_pro |= queen_w << MS_PPP;
-            // Add promotion moves
-            add_move_to_list(move_list, rook_pro); /* Add */
-            add_move_to_list(move_list, knight_pro); /* Add */
-            add_move_to_list(move_list, bishop_pro); /* Add */
-            add_move_to_list(move_list, queen_pro); /* Add */
-        } else { /* Make promotion compulsary */
+    int to; /* Target square */
+    while (targets) { /* Loop through the targets */
+        to = bitscan(targets); /* Get the index of the target */
+        move = set_move(to - offset /* from */, to, piece, (flags & MM_CAP) ? board->mailbox[to] : 0 /* captured piece id */) | flags; /* Create a new move code */
+        if (flags & MM_PRO) { /* Make promotion compulsary, one move per piece */
+            add_move_to_list(move_list, move); /* Rook promotion is of a type 0 */
+            add_move_to_list(move_list, move | (move_t)knight_w << MS_PPP);
+            add_move_to_list(move_list, move | (move_t)bishop_w << MS_PPP);
+            add_move_to_list(move_list, move | (move_t)queen_w << MS_PPP);
+        } else {
             add_move_to_list(move_list, move); /* Add move to move list */
         }
-        move_set ^= position; /* Reset LSB (remove bit from list */
+        targets &= targets - 1; /* Reset LSB (remove bit from list) */
     }
 }
+
+SIDE_SPECIALIZED_GENERATOR(generate_pawn_moves)
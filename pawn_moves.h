@@ -1,6 +1,7 @@
 /* pawn_moves.h */
 #ifndef MOVEGEN_PAWNMOVES_H
 #define MOVEGEN_PAWNMOVES_H
-void generate_pawn_moves(move_list_t *move_list, Bitboard *board);
-void add_pawn_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int pawn_index, U64 promotion_check, U64 enpas_check);
+void generate_pawn_moves(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_pawn_moves_w(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_pawn_moves_b(move_list_t *move_list, Bitboard *board, int gen_type);
 #endif
@@ -14,6 +14,7 @@
 #include "lookup_tables.h"
 #include "legality_test.h"
 #include "generate_moves.h"
+#include "legal_moves.h"
 #include "perft_test.h"
 #include "search.h"
 #include "evaluation.h"
@@ -24,6 +25,7 @@
 #define INF INT_MAX
 
 int count_moves(Bitboard *board, int depth); /* Forward declaration */
+int count_moves_pseudo_legal(Bitboard *board, int depth);
 void do_test(Bitboard *board, int maxdepth); /* Ditto */
 
 void play_game(Bitboard *board, int side) {
@@ -31,7 +33,7 @@ void play_game(Bitboard *board, int side) {
         if (board->side == side) {
             /* Human move */
             move_list_t random = {0,0};
-            generate_moves(board, &random);
+            generate_legal_moves(board, &random);
             for (int i = 0; i < random.count; i++){
                 print_move(random.moves[i]);
             }
@@ -39,29 +41,25 @@ void play_game(Bitboard *board, int side) {
             printf("Enter move: ");
             fgets(move_title, 300, stdin);
             move_list_t moves = {0,0};
-            generate_moves(board, &moves);
+            generate_legal_moves(board, &moves);
             for (int i = 0; i < moves.count; i++) {
                 char this_name[300] = {0};
                 move_name(moves.moves[i], this_name);
                 if (strcmp(move_title, this_name) == 0) {
-                    U64 a, b, c;
-                    int d;
                     system("clear");
                     printf("The Cactus - a chess AI that is supposed to defeat humans in chess \n\n");
-                    make_move(board, moves.moves[i], &a, &b, &c, &d);
+                    make_move(board, moves.moves[i]);
                     render_board(board);
                     break;
                 }
             }
         } else {
             hash_move_used = 0;
-            id_result_t result = iterative_deepening(board, 10); /* Search for 10 seconds */
-            U64 a, b, c;
-            int d;
+            id_result_t result = iterative_deepening(board, 10000, 0); /* Search for 10 seconds */
             move_t move = result.move;
             system("clear");
             printf("The Cactus - a chess AI that is supposed to defeat humans in chess \n\n");
-            make_move(board, move, &a, &b, &c, &d);
+            make_move(board, move);
             render_board(board);
             printf("Move: "); print_move(move);
             printf("Evaluation: %d\n", -result.evaluation);
@@ -91,29 +89,54 @@ void do_test(Bitboard *board, int maxdepth) {
         // Print debugging data
         printf("Move count (at depth %d) - %d\n", depth, move_count);
         printf("    Captures - %d, EP Captures - %d, Promotions - %d, Castling - %d\n", captures, enpas_caps, promotions, castling_moves);
+        int pseudo_legal_count = count_moves_pseudo_legal(board, depth); /* Cross check the legal move generator */
+        if (pseudo_legal_count != move_count) printf("    MISMATCH - %d with the pseudo-legal generator\n", pseudo_legal_count);
         depth++;
     }
     printf("\n\n");
 }
 
 int count_moves(Bitboard *board, int depth) {
-    /* Counts all moves at a certian depth */
+    /* Counts all moves at a certian depth, with the legal move generator */
+    if (!depth) return 1;
+    move_list_t moves = {0,0}; /* Legal move list */
+    generate_legal_moves(board, &moves);
+    if (depth == 1) { /* Every legal move is a leaf, so they don't have to be made */
+        for (int i = 0; i < moves.count; i++) {
+            move_t move = moves.moves[i];
+            if (move & MM_CAP || move & MM_EPC) captures++;
+            if (move & MM_CAS) castling_moves++;
+            if (move & MM_EPC) enpas_caps++;
+            if (move & MM_PRO) promotions++;
+        }
+        return moves.count;
+    }
+    int count = 0;
+    for (int i = 0; i < moves.count; i++) { /* Loop through all legal moves */
+        make_move(board, moves.moves[i]); /* make the move */
+        count += count_moves(board, depth - 1); /* The counting is recursive */
+        unmake_move(board, moves.moves[i]); /* unmake the move */
+    }
+    return count;
+}
+
+int count_moves_pseudo_legal(Bitboard *board, int depth) {
+    /* Counts all moves at a certian depth, with the pseudo-legal move generator and is_legal (to cross check the legal move generator) */
     if (depth) { /* Not reached end of search */
         // Generate all possible moves
         move_list_t moves = {0,0}; /* Pseudo-legal move list */
         generate_moves(board, &moves);
         // Do the recursive loop
         int count = 0;
-        U64 enpas, castling_rights, key; int ps_eval; /* For unmake move */
         move_t move;
         int local_count = 0;
         for (int i = 0; i < moves.count; i++) { /* Loop through all pseudo-legal moves */
             if (is_legal(board, moves.moves[i])) { /* If this is a legal move */
                 move = moves.moves[i];
-                make_move(board, moves.moves[i], &enpas, &castling_rights, &key, &ps_eval); /* make the move */
-                local_count = count_moves(board, depth - 1); /* The counting is recursive */
+                make_move(board, moves.moves[i]); /* make the move */
+                local_count = count_moves_pseudo_legal(board, depth - 1); /* The counting is recursive */
                 count += local_count;
-                unmake_move(board, moves.moves[i], &enpas, &castling_rights, &key, &ps_eval); /* unmake the move */
+                unmake_move(board, moves.moves[i]); /* unmake the move */
                 if (depth == 1) {
                     if (move & MM_CAP || move & MM_EPC) {
                         captures++;
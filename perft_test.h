@@ -1,6 +1,7 @@
 #ifndef PERFTTEST_H
 #define PERFTTEST_H
 int count_moves(Bitboard *board, int depth); /* Forward declaration */
+int count_moves_pseudo_legal(Bitboard *board, int depth);
 void do_test(Bitboard *board, int maxdepth); /* Ditto */
 void play_game(Bitboard *board, int side);
 #endif
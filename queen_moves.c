@@ -13,14 +13,13 @@
 #include "rook_moves.h"
 #include "bishop_moves.h"
 
-void add_queen_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int from, U64 enemy_mask);
+SIDE_INLINE void add_queen_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int from, U64 enemy_mask, const int side);
 
-void generate_queen_moves(move_list_t *move_list, Bitboard *board) {
+SIDE_INLINE void generate_queen_moves_side(move_list_t *move_list, Bitboard *board, int gen_type, const int side) {
     /* Generates all possible moves by moving queens, and adds them to the move list */
     // Masks
-    int side = board->side; /* Side to move */
-    U64 own_mask = colour_mask(board, side); /* Piece mask of own side */
-    U64 enemy_mask = colour_mask(board, !side); /* Piece mask of enemy pieces */
+    U64 own_mask = board->occupancy[side]; /* Piece mask of own side */
+    U64 enemy_mask = board->occupancy[!side]; /* Piece mask of enemy pieces */
     // Declare for loop
     U64 queens = (side) ? board->pieces[queen_w] : board->pieces[queen_b]; /* Queens bitboard */
     U64 position = 0; /* Queen position (current bit) */
@@ -32,14 +31,14 @@ void generate_queen_moves(move_list_t *move_list, Bitboard *board) {
         queen_index = bitscan(position); /* Get index of queen */
         /* Queen move set is a union of the rook move set and the bishop move set */
         move_set = magic_rook_moves(queen_index, own_mask, enemy_mask) | magic_bishop_moves(queen_index, own_mask, enemy_mask); /* Get queen move set using magic bitboard lookup */
-        add_queen_moves(move_set, board, move_list, queen_index, enemy_mask); /* Add the moves from this move set to the move list */
+        move_set &= target_mask(own_mask, enemy_mask, gen_type); /* Remove the squares we don't want */
+        add_queen_moves(move_set, board, move_list, queen_index, enemy_mask, side); /* Add the moves from this move set to the move list */
         queens ^= position; /* Reset LSB */
     }
 }
 
-void add_queen_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int from, U64 enemy_mask) {
+SIDE_INLINE void add_queen_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int from, U64 enemy_mask, const int side) {
     /* Adds all the queen moves from a move set to the move list */
-    int side = board->side; /* Makes code writing easier */
     // Declare for loop
     U64 position;
     U64 cap_flag; /* Check if move is a capture */
@@ -50,7 +49,7 @@ void add_queen_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int
         position = move_set & -move_set; /* Isolate LSB */
         pos_index = bitscan(position); /* Get the index of the move */
         cap_flag = position & enemy_mask; /* Check if this is a capture move */
-        if (cap_flag) cap_piece = get_captured_piece(board, position, side); /* Get captured piece id (if there is one) */
+        if (cap_flag) cap_piece = board->mailbox[pos_index]; /* Get captured piece id (if there is one) */
         move = set_move(from, pos_index /* to */, (side) ? queen_w : queen_b /* Piece */, (cap_flag) ? cap_piece : 0 /* Captured piece id */);
         // Set flags
         if (cap_flag) move |= MM_CAP; /* If this is a capture move, set the capture flag */
@@ -60,3 +59,4 @@ void add_queen_moves(U64 move_set, Bitboard *board, move_list_t *move_list, int
     }
 }
 
+SIDE_SPECIALIZED_GENERATOR(generate_queen_moves)
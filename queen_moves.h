@@ -1,6 +1,8 @@
 /* header file for queen_moves.c */
 #ifndef MOVEGEN_QUEENMOVES_H
 #define MOVEGEN_QUEENMOVES_H
-void generate_queen_moves(move_list_t *move_list, Bitboard *board);
+void generate_queen_moves(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_queen_moves_w(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_queen_moves_b(move_list_t *move_list, Bitboard *board, int gen_type);
 #define magic_queen_moves(square, own_mask, enemy_mask) (magic_rook_moves(square, own_mask, enemy_mask) | magic_bishop_moves(square, own_mask, enemy_mask)) /* Macro for queen magic looku. Basically | of rook and bishop moves */
 #endif
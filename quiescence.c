@@ -13,61 +13,62 @@
 #include "generate_moves.h"
 #include "lookup_tables.h"
 #include "evaluation.h"
+#include "eval_cache.h"
 #include "search.h" /* result_t typedef */
+#include "see.h"
+#include "legal_moves.h"
 #include "move_ordering.h"
+#include "time_manager.h"
 
-#define INF INT_MAX
+#define INF SCORE_INF
 #define DELTA 200 /* Used for delta pruning */
 
 result_t quiescence(Bitboard *board, int alpha, int beta) {
     /* Evaluates moves only with no captures */
     // Declare for minmax
-    int index; /* Useful for looping over moves */
     move_t move; /* Use this in loops */
-    move_list_t pseudo_legal = {0,0}; /* Create a move list for pseudo-legal moves */
-    move_list_t legal_moves = {0,0}; /* This list will only contain legal moves */
+    scored_move_t *picked; /* Current capture, with its score */
+    move_list_t generated = {0,0}; /* Create a move list for the captures */
+    scored_list_t captures; /* The captures with their scores */
+    nodes_searched++; /* Count this node */
+    if (!(nodes_searched & (TIME_CHECK_NODES - 1))) /* Once every few nodes */
+        check_time(); /* Stop searching if the time is up */
+    if (stop_search) /* If the search has been interrupted */
+        return (result_t){0,0}; /* Get out, the result will be thrown away */
 
     // Evaluate Standing-Pat
-    int evaluation = evaluate(board); /* Return evaluation */
+    int evaluation = cached_evaluate(board); /* Return evaluation */
 
     if (evaluation >= beta) /* alpha-beta pruning */
         return (result_t){beta, 0}; /* Prune this branch */
     if (evaluation > alpha) /* That Standing-PAT thing */
         alpha = evaluation; /* Set the alpha to the current evaluation */
 
-    // Generate legal moves
-    generate_moves(board, &pseudo_legal); /* Generate pseudo legal moves */
-    for (index = 0; index < pseudo_legal.count; index++) { /* Loop through the pseudo-legal moves to filter out illegal ones */
-        move = pseudo_legal.moves[index]; /* Get the move */
-        if (is_legal(board, move) && (move & MM_CAP)) { /* If this move is a legal capture */
-            add_move_to_list(&legal_moves, move); /* Add it to the list of legal moves */
-        }
-    }
-
-    if (legal_moves.count == 0) { /* There are no captures left */
-        return (result_t){evaluation, 0}; /* Just return an evaluation */
-    }
-    
-    order_moves(&legal_moves, board, 0, 0); /* Order moves to increase number of cutoffs during search */
+    // Generate captures
+    generate_legal_captures(board, &generated); /* Generate legal captures */
+    score_moves(&generated, &captures, board, 0); /* Score moves to increase number of cutoffs during search, they are sorted as they are picked */
 
-    // There are captures left, continue search
+    // Continue search with the captures
     result_t result; /* Current result */
-    move_t max_move = legal_moves.moves[0]; /* The move with the highest evaluation */
-    int piece;
-    int cap_piece;
-    U64 castling, enpas, key; int ps_eval; /* Used for make/unmake */
-    for (index = 0; index < legal_moves.count; index++) { /* Loop through all the legal moves */
-        move = legal_moves.moves[index]; /* Current move */
+    move_t max_move = 0; /* The move with the highest evaluation */
+    int searched = 0; /* Number of captures searched */
+    while ((picked = pick_next_best(&captures))) { /* Loop through all the captures, best first */
+        move = picked->move; /* Current move */
+        if (!(move & MM_CAP)) continue; /* Only real captures (not en-passant captures or quiet promotions) */
         
         // Delta pruning
         int cap_piece = (move & MM_EAT) >> MS_EAT;
         if ((evaluation + materials[cap_piece] + DELTA) < alpha) /* If the evaluation + the captured piece material + some margin cannot raise the alpha, prune this branch */
             continue;
+        if (picked->losing) continue; /* Don't search captures that lose material (the exchange was done when scoring) */
 
+        if (!searched++) max_move = move; /* Until something better is found */
 
-        make_move(board, move, &enpas, &castling, &key, &ps_eval); /* Make the move on the board */
+        make_move(board, move); /* Make the move on the board */
         result = quiescence(board, -beta, -alpha); /* Recursively call itself to search at an even higher depth */
-        unmake_move(board, move, &enpas, &castling, &key, &ps_eval); /* Unmake the move on the board */
+        unmake_move(board, move); /* Unmake the move on the board */
+        if (stop_search) /* If the search has been interrupted */
+            return (result_t){0,0}; /* Get out */
 
         // Alpha-beta pruning
         if (-result.evaluation >= beta) { /* Evaluation better than last best */
@@ -81,5 +82,7 @@ result_t quiescence(Bitboard *board, int alpha, int beta) {
         }
     }
 
+    if (!searched) /* There are no captures left */
+        return (result_t){evaluation, 0}; /* Just return an evaluation */
     return (result_t){alpha, max_move}; /* Return the result */
 }
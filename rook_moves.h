@@ -1,7 +1,11 @@
 /* header file for rook_moves.c */
 #ifndef MOVEGEN_ROOKMOVES_H
 #define MOVEGEN_ROOKMOVES_H
-void generate_rook_moves(move_list_t *move_list, Bitboard *board);
-U64 magic_rook_moves(int square, U64 own, U64 enemy);
+void generate_rook_moves(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_rook_moves_w(move_list_t *move_list, Bitboard *board, int gen_type);
+void generate_rook_moves_b(move_list_t *move_list, Bitboard *board, int gen_type);
+U64 magic_rook_lookup(int square, U64 own, U64 enemy);
+U64 pext_rook_lookup(int square, U64 own, U64 enemy);
+extern U64 (*magic_rook_moves)(int square, U64 own, U64 enemy);
 
 #endif
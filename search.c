@@ -9,6 +9,9 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
 #include "bitboards.h"
 #include "bitboard_utils.h"
 #include "moves.h"
@@ -20,28 +23,100 @@
 #include "evaluation.h"
 #include "search.h" /* result_t typedef */
 #include "quiescence.h"
+#include "legal_moves.h"
 #include "move_ordering.h"
 #include "zobrist_hash.h"
 #include "tp_table.h"
+#include "lookup_tables.h"
+#include "time_manager.h"
+#include "pawn_hash.h"
+#include "eval_cache.h"
 
-#define INF INT_MAX
+#define INF SCORE_INF
+#define ASPIRATION_WINDOW 50 /* Initial aspiration window around the previous evaluation */
+#define ASPIRATION_MAX 800 /* Past this window size, just use an infinite bound */
+#define ASPIRATION_DEPTH 4 /* Use aspiration windows from this depth onwards */
+#define NULL_MOVE_DEPTH 3 /* Minimum depth for null move pruning */
+#define NULL_MOVE_VERIFY 300 /* Verify null move cutoffs when the side to move has this much non-pawn material or less */
+#define LMR_DEPTH 3 /* Minimum depth for late move reductions */
+#define LMR_MOVES 3 /* Number of moves searched before reducing */
+#define PRUNING_DEPTH 3 /* Futility, reverse futility and late move pruning are only done at this depth or less */
+#define FUTILITY_MARGIN 150 /* Default futility margin per ply of depth */
+#define REVERSE_FUTILITY_MARGIN 120 /* Default reverse futility margin per ply of depth */
+#define LMP_BASE 3 /* Default quiet moves searched before late move pruning, plus depth squared */
 
-result_t search(Bitboard *board, int depth, int alpha, int beta, int *interrupt_search, int max_time) {
+int search_threads = 1; /* Number of threads used for the search (lazy SMP), set at runtime */
+__thread long long nodes_searched = 0; /* Nodes searched by the current thread */
+__thread long long beta_cutoffs = 0; /* Beta cutoffs by the current thread (move ordering statistics) */
+__thread long long first_move_cutoffs = 0; /* Beta cutoffs on the first move searched */
+int lmr_table[64][256]; /* Late move reductions by depth and move number */
+int futility_margin = FUTILITY_MARGIN; /* Pruning margins, set at runtime */
+int reverse_futility_margin = REVERSE_FUTILITY_MARGIN;
+int lmp_base = LMP_BASE;
+heuristics_t thread_heuristics[MAX_THREADS]; /* Move ordering heuristics of each search thread */
+
+void init_search_tables() {
+    /* Precompute the late move reduction table */
+    for (int depth = 0; depth < 64; depth++) { /* Loop through all the depths */
+        for (int move = 0; move < 256; move++) { /* Loop through the move numbers */
+            if (!depth || !move) lmr_table[depth][move] = 0; /* log(0) */
+            else lmr_table[depth][move] = (int)(0.75 + log(depth) * log(move) / 2.25); /* Reduce later moves at higher depths more */
+        }
+    }
+}
+
+int non_pawn_material(Bitboard *board, int side) {
+    /* Material of all the pieces other than pawns (and the king) */
+    int offset = side ? 0 : 6; /* Black pieces start at 6 */
+    return popcount(board->pieces[rook_w + offset]) * materials[rook_w]
+         + popcount(board->pieces[knight_w + offset]) * materials[knight_w]
+         + popcount(board->pieces[bishop_w + offset]) * materials[bishop_w]
+         + popcount(board->pieces[queen_w + offset]) * materials[queen_w];
+}
+
+result_t search(Bitboard *board, int depth, int ply, int alpha, int beta, int null_allowed, move_t last_move, heuristics_t *heuristics) {
     /* Generate moves, recursively generate moves from resulting positions until
      * maximum depth is reached, and then evaluate the position, use minmax
      * algorithm to find best evaluation and move.
+     * ply is the distance from the root, and last_move is the move that led here (0 after a null move).
+     * null_allowed is 0 right after a null move, so that two null moves are never played in a row.
+     * heuristics holds the killer/history/countermove tables of this search thread.
     */
     
-    // Check time and search interrupt for iterative deepening
-    if ((int)time(NULL) >= max_time) /* If the search time has been exceeded */
-        *interrupt_search = 1; /* Stop searching */
+    nodes_searched++; /* Count this node */
+
+    // Check time for iterative deepening
+    if (!(nodes_searched & (TIME_CHECK_NODES - 1))) /* Once every few nodes */
+        check_time(); /* Stop searching if the time is up */
+    if (stop_search) /* If the search has been interrupted */
+        return (result_t){0,0}; /* Get out */
+
+    // Mate distance pruning
+    /* Even mating right here can't beat a mate that was already found closer to the root, so don't look for one. */
+    if (ply) {
+        if (alpha < -MATE + ply) alpha = -MATE + ply; /* Can't do worse than being checkmated now */
+        if (beta > MATE - ply - 1) beta = MATE - ply - 1; /* Can't do better than checkmating on the next move */
+        if (alpha >= beta) return (result_t){alpha, 0}; /* No score inside the window is possible */
+    }
 
     // Search for entry in tp_table
     entry_t entry = get_entry(board->key); /* Try getting the entry from the tp-table */
-    if (!invalid_entry(entry) && entry.depth >= depth && entry.node_type == node_pv) { /* If the entry is there, and the depth of the entry is greater than or equal to the current depth, and this is a pv node */
-        // Use the evaluation from the table
-        hash_move_used++;
-        return (result_t){entry.eval, entry.best_move}; /* Return the results from the table entry */
+    if (!invalid_entry(entry) && entry.depth >= depth) { /* If the entry is there, and the depth of the entry is greater than or equal to the current depth */
+        int tt_eval = score_from_tt(entry.eval, ply); /* Mate scores are stored relative to the node */
+        // Not at the root, where the best move is played (and a key collision could hand out a move that isn't even legal here)
+        if (ply && entry.node_type == node_pv) { /* Exact evaluation */
+            hash_move_used++;
+            return (result_t){tt_eval, entry.best_move}; /* Return the results from the table entry */
+        }
+        // Bounds
+        if (ply && entry.node_type == node_cut && tt_eval >= beta) { /* A lower bound that is already too good */
+            hash_move_used++;
+            return (result_t){beta, entry.best_move}; /* Fail-high */
+        }
+        if (ply && entry.node_type == node_all && tt_eval <= alpha) { /* An upper bound that can't raise alpha */
+            hash_move_used++;
+            return (result_t){alpha, entry.best_move}; /* Fail-low */
+        }
     }
 
     if (depth == 0) { /* Reached end of search */
@@ -51,92 +126,234 @@ result_t search(Bitboard *board, int depth, int alpha, int beta, int *interrupt_
         // Declare for minmax
         int index; /* Useful for looping over moves */
         move_t move; /* Use this in loops */
-        move_list_t pseudo_legal = {0,0}; /* Create a move list for pseudo-legal moves */
-        move_list_t legal_moves = {0,0}; /* This list will only contain legal moves */
-        
-        // Generate legal moves
-        generate_moves(board, &pseudo_legal); /* Generate pseudo legal moves */
-        for (index = 0; index < pseudo_legal.count; index++) { /* Loop through the pseudo-legal moves to filter out illegal ones */
-            move = pseudo_legal.moves[index]; /* Get the move */
-            if (is_legal(board, move)) { /* If this move is legal */
-                add_move_to_list(&legal_moves, move); /* Add it to the list of legal moves */
-            }
-        }
-        
-        // Check if this is checkmate
-        if (legal_moves.count == 0) { /* Checkmate/Stalemate */
-            if (is_check(board, board->side)) { /* If this is a check */
-                return (result_t){-INF, 0}; /* Return Checkmate */
-            } else { /* Stalemate */
-                return (result_t){0, 0}; /* Return stalemate */
+        int in_check = is_check(board, board->side); /* Whether the side to move is in check */
+        int pv_node = beta - alpha > 1; /* Null window searches are not pv-nodes */
+        int shallow = !pv_node && !in_check && depth <= PRUNING_DEPTH; /* Close to the leaves, where the static evaluation is trusted for pruning */
+        int static_eval = shallow ? cached_evaluate(board) : 0; /* Static evaluation (only needed for pruning) */
+
+        // Reverse futility pruning (static null move)
+        /* If the static evaluation is so far above beta that even losing a margin per ply can't bring it down, assume the search would fail high. */
+        if (shallow && !is_mate(beta) && static_eval - reverse_futility_margin * depth >= beta)
+            return (result_t){beta, 0}; /* Prune */
+        int futile = shallow && !is_mate(alpha) && static_eval + futility_margin * depth <= alpha; /* Quiet moves can't raise alpha here */
+
+        // Null move pruning
+        /* If we pass the turn and a reduced search still fails high, the position is so good that a real move would almost certainly fail high too.
+         * This breaks down in zugzwang (where any move makes things worse), so with little material the cutoff is verified with a normal reduced search.
+         * It is skipped when beta is a mate score, since passing proves nothing about a forced mate and returning beta would report an unproven mate.
+        */
+        if (null_allowed && !pv_node && !in_check && depth >= NULL_MOVE_DEPTH && !is_mate(beta)) {
+            int reduction = (depth > 6) ? 3 : 2; /* Null move depth reduction */
+            int null_depth = cutoff(depth - 1 - reduction);
+            make_null_move(board); /* Pass */
+            result_t null_result = search(board, null_depth, ply + 1, -beta, -beta + 1, 0, 0, heuristics); /* Search with a null window around beta */
+            unmake_null_move(board); /* Take back the pass */
+            if (stop_search) /* If the search has been interrupted */
+                return (result_t){0,0}; /* Get out */
+            if (-null_result.evaluation >= beta) { /* Still fails high */
+                if (non_pawn_material(board, board->side) > NULL_MOVE_VERIFY) /* Enough pieces, zugzwang is unlikely */
+                    return (result_t){beta, 0}; /* Prune */
+                // Zugzwang-prone material, verify the cutoff without null moves
+                result_t verify = search(board, null_depth, ply, beta - 1, beta, 0, last_move, heuristics); /* Verification search */
+                if (stop_search) return (result_t){0,0}; /* Get out */
+                if (verify.evaluation >= beta) /* Verified */
+                    return (result_t){beta, verify.move}; /* Prune */
             }
         }
         
-
-        // Order the moves
-        if (invalid_entry(entry)) { /* If there is no hash move */
-            /* Use the normal move ordering technique */
-            order_moves(&legal_moves, board, 0, 0); /* Order moves to increase number of cutoffs during search */
-        } else { /* If there is a hash move available */
-            order_moves(&legal_moves, board, 1, entry.best_move); /* Again, Hash move - Best move ! */
-        }
-
-        // This is not a checkmate, continue search
+        // This is not a checkmate (yet), continue search
+        move_picker_t picker; /* Hands out the moves one stage at a time */
+        init_move_picker(&picker, board, invalid_entry(entry) ? 0 : entry.best_move, heuristics, ply, last_move); /* Hash move - Best move ! */
         node_t node_type = node_all; /* At first assume all-node */
         result_t result; /* Current result */
-        move_t max_move = legal_moves.moves[0]; /* The move with the highest evaluation */
-        U64 castling, enpas, key; int ps_eval; /* Used for make/unmake */
-        for (index = 0; index < legal_moves.count; index++) { /* Loop through all the legal moves */
-            move = legal_moves.moves[index]; /* Current move */
-            make_move(board, move, &enpas, &castling, &key, &ps_eval); /* Make the move on the board */
-            result = search(board, depth - 1, -beta, -alpha, interrupt_search, max_time); /* Recursively call itself to search at an even higher depth */
-            unmake_move(board, move, &enpas, &castling, &key, &ps_eval); /* Unmake the move on the board */
+        move_t max_move = 0; /* The move with the highest evaluation */
+        int legal_count = 0; /* Number of legal moves (only for the checkmate/stalemate test) */
+        int searched = 0; /* Number of moves actually searched (pruned moves don't count towards the reductions) */
+        move_t quiets_tried[64]; /* Quiet moves searched before a cutoff (their history goes down) */
+        int quiet_count = 0;
+        while ((move = next_move(&picker))) { /* Loop through the moves, best first */
+            legal_count++;
+
+            // Futility and late move pruning
+            /* At shallow depths, skip quiet moves that don't give check when:
+             *  -> The static evaluation plus a margin can't reach alpha (futility).
+             *  -> Enough quiet moves have already been tried, since late ones almost never cause a cutoff (late move pruning).
+             * The first move is always searched, so that there is a result to return.
+             * This is decided before the move is made, so pruned moves cost next to nothing.
+            */
+            if (searched && shallow && !is_mate(alpha) && !(move & (MM_CAP | MM_EPC | MM_PRO)) && (futile || quiet_count >= lmp_base + depth * depth) && !gives_check(board, move))
+                continue; /* Skip it without searching */
+
+            index = searched++; /* Number of moves searched before this one */
+            if (index == 0) max_move = move; /* Until something better is found */
+            prefetch_entry(child_key(board, move)); /* Start loading the child's tp table entry while the move is being made */
+            make_move(board, move); /* Make the move on the board */
+            if (index == 0) { /* First move (probably the best one), search with the full window */
+                result = search(board, depth - 1, ply + 1, -beta, -alpha, 1, move, heuristics); /* Recursively call itself to search at an even higher depth */
+            } else { /* Principal variation search */
+                /* Assume the first move was the best, and just prove that this move can't raise alpha using a null window.
+                 * If it does (fail-high), it may be a better move, so re-search it with the full window.
+                */
+                // Late move reductions
+                /* Moves late in the ordering are unlikely to be good, so search quiet ones at a reduced depth first. */
+                int reduction = 0;
+                if (depth >= LMR_DEPTH && index >= LMR_MOVES && !in_check && !(move & (MM_CAP | MM_PRO)) && !is_check(board, board->side)) { /* Quiet move that doesn't give check */
+                    reduction = lmr_table[depth < 64 ? depth : 63][index < 256 ? index : 255]; /* Lookup the reduction */
+                    if (pv_node && reduction) reduction--; /* Reduce pv-nodes less */
+                    if (reduction > depth - 2) reduction = depth - 2; /* Don't drop straight into quiescence */
+                }
+                result = search(board, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha, 1, move, heuristics); /* Null window search */
+                if (reduction && -result.evaluation > alpha) /* The reduced search failed high, search at full depth */
+                    result = search(board, depth - 1, ply + 1, -alpha - 1, -alpha, 1, move, heuristics); /* Null window search */
+                if (-result.evaluation > alpha && -result.evaluation < beta) /* Fail-high, this might be better than the pv */
+                    result = search(board, depth - 1, ply + 1, -beta, -alpha, 1, move, heuristics); /* Re-search with the full window */
+            }
+            unmake_move(board, move); /* Unmake the move on the board */
             
-            if (*interrupt_search) /* If the search has been interrupted */
+            if (stop_search) /* If the search has been interrupted */
                 return (result_t){0,0}; /* Get out */
             
             // Alpha-beta pruning
             if (-result.evaluation >= beta) { /* Evaluation better than last best */
                 /* Prune this branch, since the opponent will not consider this position */
                 node_type = node_cut; /* Set it to a cut node, since this branch will be pruned */
-                add_entry(board->key, beta, depth, board->moves, move, node_type); /* Add the entry to the transposition table */
+                beta_cutoffs++; /* Ordering statistics */
+                if (index == 0) first_move_cutoffs++; /* The best move was tried first */
+                if (!(move & (MM_CAP | MM_EPC | MM_PRO))) /* Quiet move, remember it for move ordering */
+                    update_heuristics(heuristics, board, move, depth, ply, last_move, quiets_tried, quiet_count);
+                add_entry(board->key, score_to_tt(beta, ply), depth, move, node_type); /* Add the entry to the transposition table */
                 return (result_t){beta, move}; /* Need not search further */
             }
 
+            if (!(move & (MM_CAP | MM_EPC | MM_PRO)) && quiet_count < 64) quiets_tried[quiet_count++] = move; /* Didn't cause a cutoff */
+
             if (alpha < -result.evaluation) {
                 node_type = node_pv; /* Alpha has been updated, set it to a pv-node */
                 alpha = -result.evaluation; /* Update best eval */
                 max_move = move; /* Update best move */
             }
         }
-        
+
+        // Check if this is checkmate
+        if (legal_count == 0) { /* Checkmate/Stalemate */
+            if (in_check) { /* If this is a check */
+                return (result_t){-MATE + ply, 0}; /* Return Checkmate (mates closer to the root score higher) */
+            } else { /* Stalemate */
+                return (result_t){0, 0}; /* Return stalemate */
+            }
+        }
 
         // Update result in TP Table
-        add_entry(board->key, alpha, depth, board->moves, max_move, node_type); /* Add the entry to the transposition table */
+        add_entry(board->key, score_to_tt(alpha, ply), depth, max_move, node_type); /* Add the entry to the transposition table */
 
         return (result_t){alpha, max_move}; /* Return the result */
     }
 }
 
-id_result_t iterative_deepening(Bitboard *board, int search_time) {
-    /* Searches the board using iterative deepening */
+result_t aspiration_search(Bitboard *board, int depth, int previous, heuristics_t *heuristics) {
+    /* Search the root with a small window around the previous iteration's evaluation.
+     * If the search fails low or high, widen that side of the window (doubling it each time) and search again.
+    */
+    int alpha = -INF, beta = INF; /* Search window */
+    int alpha_window = ASPIRATION_WINDOW, beta_window = ASPIRATION_WINDOW; /* Size of each side of the window */
+    result_t result;
+    if (depth >= ASPIRATION_DEPTH && !is_mate(previous)) { /* Only use a window when the previous evaluation is reliable (and not a mate) */
+        alpha = previous - alpha_window;
+        beta = previous + beta_window;
+    }
+    while (1) { /* Until the evaluation is inside the window */
+        result = search(board, depth, 0, alpha, beta, 0, 0, heuristics); /* Search with the window (no null move at the root) */
+        if (stop_search) return result; /* No time to re-search */
+        if (result.evaluation <= alpha && alpha != -INF) { /* Fail-low, widen alpha */
+            alpha_window *= 2;
+            alpha = (alpha_window > ASPIRATION_MAX) ? -INF : previous - alpha_window;
+        } else if (result.evaluation >= beta && beta != INF) { /* Fail-high, widen beta */
+            beta_window *= 2;
+            beta = (beta_window > ASPIRATION_MAX) ? INF : previous + beta_window;
+        } else return result; /* The evaluation is exact */
+    }
+}
+
+typedef struct helper_data_t {
+    /* Data for a lazy SMP helper thread */
+    Bitboard board; /* The helper's own copy of the board */
+    int id; /* Thread index (the main thread is 0) */
+    long long nodes; /* Nodes searched by this helper */
+} helper_data_t;
+
+void *helper_search(void *data_pointer) {
+    /* Lazy SMP helper thread.
+     * Runs its own iterative deepening on a copy of the board, and only shares results with the other threads through the tp_table.
+     * Odd helpers start a ply ahead of the main thread so that the threads don't all search the same depth at the same time.
+    */
+    helper_data_t *data = (helper_data_t*)data_pointer; /* Cast the data */
+    int depth = data->id & 1; /* Stagger the starting depth */
+    result_t result = {0,0}; /* Result of the last iteration */
+    heuristics_t *heuristics = &thread_heuristics[data->id]; /* This thread's move ordering heuristics */
+    use_pawn_table(data->id); /* Pick up the pawn formations this helper evaluated in earlier searches */
+    nodes_searched = 0; /* Reset the node count for this thread */
+    memset(heuristics->killers, 0, sizeof(heuristics->killers)); /* Killers from the last search are at the wrong plies */
+    while (!stop_search && depth < MAX_PLY - 1) { /* Until the search is stopped */
+        depth++; /* Increase the depth */
+        age_heuristics(heuristics); /* Older iterations count less */
+        result = aspiration_search(&data->board, depth, result.evaluation, heuristics);
+    }
+    data->nodes = nodes_searched; /* Report back */
+    return 0;
+}
+
+id_result_t iterative_deepening(Bitboard *board, int search_time, int max_depth) {
+    /* Searches the board using iterative deepening.
+     * search_time is in milliseconds (0 for no time limit), and max_depth limits the depth of the search (0 for no limit).
+     * If search_threads > 1, helper threads are launched to search the same position (lazy SMP).
+    */
     int depth = 0; /* Current depth */
-    int max_time; /* Maximum time */
-    int interrupt_search = 0; /* Whether to interrupt the search */
-    id_result_t result; /* The final iterative deepening result */
-    result_t current_result; /* The Current Result */
+    id_result_t result = {0,0,0,0}; /* The final iterative deepening result */
+    result_t current_result = {0,0}; /* The Current Result */
+    pthread_t helper_threads[MAX_THREADS]; /* Lazy SMP helpers */
+    helper_data_t helpers[MAX_THREADS]; /* Their data */
+    int helper_count = (search_threads < MAX_THREADS ? search_threads : MAX_THREADS) - 1; /* Number of helper threads to launch */
+    int index;
     
-    max_time = (int)time(NULL); /* Get the current time */
-    max_time += search_time; /* Add the time taken to search */
+    start_timer(search_time); /* Start the clock */
+    new_search_tp_table(); /* Entries from earlier searches are now older */
+
+    // Launch helper threads
+    for (index = 0; index < helper_count; index++) { /* Launch all the helpers */
+        helpers[index].board = *board; /* Each helper gets its own copy of the board */
+        helpers[index].id = index + 1;
+        helpers[index].nodes = 0;
+        pthread_create(&helper_threads[index], NULL, helper_search, &helpers[index]); /* Start searching */
+    }
+    use_pawn_table(0); /* The main thread's pawn table (this may be a different thread from the last search) */
+    nodes_searched = 0; /* Reset the node count of the main thread */
+    memset(thread_heuristics[0].killers, 0, sizeof(thread_heuristics[0].killers)); /* Killers from the last search are at the wrong plies */
+    beta_cutoffs = first_move_cutoffs = 0; /* Reset the ordering statistics */
+    tp_probes = tp_hits = 0; /* And the table statistics */
+    pawn_probes = pawn_hits = 0;
+    eval_probes = eval_hits = 0;
 
-    while (!interrupt_search) { /* Until the search has not been interrupted */
+    while (!stop_search) { /* Until the search has not been interrupted */
         // Set the previous result
         result.evaluation = current_result.evaluation;
         result.move = current_result.move;
         result.depth = depth;
+        if ((max_depth && depth >= max_depth) || depth >= MAX_PLY - 1) break; /* Reached the depth limit */
+        if (depth && is_mate(result.evaluation) && MATE - abs(result.evaluation) <= depth) break; /* Found a forced mate within the full search depth, searching deeper won't find a shorter one */
+        if (depth) arm_hard_limit(); /* There is a move to play now, so the search can be stopped at any time */
+        if (depth && soft_limit_reached()) break; /* Not enough time left to finish another iteration */
         // Do the search
         depth++; /* Increase the depth */
-        current_result = search(board, depth, -INF, INF, &interrupt_search,(depth >= 4) ? max_time : INF); /* Search at the current depth */
+        age_heuristics(&thread_heuristics[0]); /* Older iterations count less */
+        current_result = aspiration_search(board, depth, current_result.evaluation, &thread_heuristics[0]); /* Search at the current depth */
+    }
+
+    // Stop the helpers
+    stop_search = 1; /* Tell the helpers to stop */
+    result.nodes = nodes_searched;
+    for (index = 0; index < helper_count; index++) { /* Wait for all the helpers to finish */
+        pthread_join(helper_threads[index], NULL);
+        result.nodes += helpers[index].nodes; /* Add their nodes to the total */
     }
 
     return result;
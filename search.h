@@ -1,6 +1,13 @@
 /* header file for search.c */
 #ifndef SEARCH_H
 #define SEARCH_H
+#define MAX_THREADS 64 /* Maximum number of search threads */
+// Score range
+#define SCORE_INF 32000 /* Larger than any score, and small enough that negating a score can never overflow */
+#define MATE 31000 /* Being checkmated n plies from the root scores -(MATE - n) */
+#define MATE_BOUND 30000 /* Scores past this are mates */
+#define is_mate(score) ((score) > MATE_BOUND || (score) < -MATE_BOUND)
+struct heuristics_t; /* Move ordering heuristics (move_ordering.h) */
 typedef struct search_result {
     /* Search restult */
     int evaluation;
@@ -12,9 +19,19 @@ typedef struct iterative_result {
     int evaluation;
     move_t move;
     int depth;
+    long long nodes; /* Nodes searched by all the threads */
 } id_result_t;
 
-result_t search(Bitboard *board, int depth, int alpha, int beta, int *interrupt_search, int max_time);
-id_result_t iterative_deepening(Bitboard *board, int search_time);
+result_t search(Bitboard *board, int depth, int ply, int alpha, int beta, int null_allowed, move_t last_move, struct heuristics_t *heuristics);
+void init_search_tables();
+result_t aspiration_search(Bitboard *board, int depth, int previous, struct heuristics_t *heuristics);
+id_result_t iterative_deepening(Bitboard *board, int search_time, int max_depth);
+extern int search_threads;
+extern int futility_margin;
+extern int reverse_futility_margin;
+extern int lmp_base;
+extern __thread long long nodes_searched;
+extern __thread long long beta_cutoffs;
+extern __thread long long first_move_cutoffs;
 #endif
 
@@ -0,0 +1,92 @@
+/* see.c
+ * Static Exchange Evaluation.
+ * Plays out all the captures on one square (least valuable attacker first) without making any moves,
+ * to find out if a capture wins or loses material.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "bitboards.h"
+#include "bitboard_utils.h"
+#include "moves.h"
+#include "move_utils.h"
+#include "lookup_tables.h"
+#include "rook_moves.h"
+#include "bishop_moves.h"
+#include "see.h"
+
+#define SEE_KING 20000 /* The king can only capture last, since any capture back would be illegal */
+#define SEE_MAX_DEPTH 32 /* There can never be more captures than pieces on the board */
+
+static const int see_values[12] = {500, 300, 300, 900, SEE_KING, 100, 500, 300, 300, 900, SEE_KING, 100}; /* Same as the materials, but with a king value */
+static const int see_order[2][6] = {{pawn_b, knight_b, bishop_b, rook_b, queen_b, king_b}, {pawn_w, knight_w, bishop_w, rook_w, queen_w, king_w}}; /* Least valuable attacker first, by side */
+
+U64 attackers_to(Bitboard *board, int square, U64 occupied) {
+    /* Get all the pieces of both sides that attack a square, with the sliding pieces blocked by the given occupancy */
+    U64 diagonal = board->pieces[bishop_w] | board->pieces[bishop_b] | board->pieces[queen_w] | board->pieces[queen_b]; /* Pieces that move diagonally */
+    U64 straight = board->pieces[rook_w] | board->pieces[rook_b] | board->pieces[queen_w] | board->pieces[queen_b]; /* Pieces that move along files and ranks */
+    return (pawn_attacks_w[square] & board->pieces[pawn_b]) /* Black pawns attack the squares a white pawn would attack from here */
+         | (pawn_attacks_b[square] & board->pieces[pawn_w]) /* And the other way around */
+         | (knight_attacks[square] & (board->pieces[knight_w] | board->pieces[knight_b]))
+         | (king_attacks[square] & (board->pieces[king_w] | board->pieces[king_b]))
+         | (magic_bishop_moves(square, 0, occupied) & diagonal)
+         | (magic_rook_moves(square, 0, occupied) & straight);
+}
+
+int see(Bitboard *board, move_t move) {
+    /* Get the material won (or lost, if negative) by the side to move after all the captures on the move's square are played out.
+     * Uses the swap algorithm:
+     *  -> Find all the attackers of the square.
+     *  -> Both sides keep capturing with their least valuable attacker, and the sliding pieces behind the capturing piece are added (x-rays).
+     *  -> Minimax the list of gains backwards, since either side can stop capturing when it would lose material.
+    */
+    if (move & MM_CAS) return 0; /* Castling never captures anything */
+    int gain[SEE_MAX_DEPTH]; /* Material balance after each capture */
+    int depth = 0; /* Number of captures played out */
+    int from = move & MM_FROM;
+    int to = (move & MM_TO) >> MS_TO;
+    int piece = (move & MM_PIECE) >> MS_PIECE; /* The first capturing piece */
+    int side = board->side; /* Side to capture next */
+    int attacker_value = see_values[piece]; /* Value of the piece standing on the square, which can be captured next */
+    U64 occupied = board->occupied; /* All pieces on the board */
+    U64 diagonal = board->pieces[bishop_w] | board->pieces[bishop_b] | board->pieces[queen_w] | board->pieces[queen_b]; /* Pieces that can x-ray diagonally */
+    U64 straight = board->pieces[rook_w] | board->pieces[rook_b] | board->pieces[queen_w] | board->pieces[queen_b]; /* Pieces that can x-ray along files and ranks */
+    U64 from_mask = 1ULL << from; /* The piece that is capturing */
+    U64 attackers = attackers_to(board, to, occupied);
+
+    gain[0] = (move & MM_CAP) ? see_values[(move & MM_EAT) >> MS_EAT] : 0; /* Material won by the move itself */
+    if (move & MM_EPC) { /* The captured pawn is not on the to square */
+        gain[0] = see_values[pawn_w];
+        occupied ^= 1ULL << (side ? to - 8 : to + 8); /* Remove it, since it might be blocking a slider */
+    }
+    if (move & MM_PRO) { /* The pawn turns into something else */
+        attacker_value = see_values[(move & MM_PPP) >> MS_PPP];
+        gain[0] += attacker_value - see_values[pawn_w];
+    }
+
+    do {
+        depth++; /* Next capture */
+        side = !side; /* By the other side */
+        gain[depth] = attacker_value - gain[depth - 1]; /* If the piece on the square is captured, and nothing recaptures */
+        if ((-gain[depth - 1] > gain[depth] ? -gain[depth - 1] : gain[depth]) < 0) break; /* Neither side can do better by continuing */
+        attackers ^= from_mask; /* The last capturing piece has moved to the square */
+        occupied ^= from_mask;
+        if (from_mask & (diagonal | board->pieces[pawn_w] | board->pieces[pawn_b])) attackers |= magic_bishop_moves(to, 0, occupied) & diagonal; /* Diagonal x-rays */
+        if (from_mask & straight) attackers |= magic_rook_moves(to, 0, occupied) & straight; /* Straight x-rays */
+        attackers &= occupied; /* Don't count pieces that already captured */
+
+        // Find the least valuable attacker of the side to capture
+        from_mask = 0;
+        for (int index = 0; index < 6; index++) { /* Pawns first, king last */
+            U64 candidates = attackers & board->pieces[see_order[side][index]];
+            if (candidates) {
+                from_mask = candidates & -candidates; /* Isolate LSB */
+                attacker_value = see_values[see_order[side][index]]; /* This piece now stands on the square */
+                break;
+            }
+        }
+    } while (from_mask && depth < SEE_MAX_DEPTH - 1); /* Until one side runs out of attackers */
+
+    while (--depth) /* Either side can choose not to capture */
+        gain[depth - 1] = -(-gain[depth - 1] > gain[depth] ? -gain[depth - 1] : gain[depth]);
+    return gain[0];
+}
@@ -0,0 +1,6 @@
+/* Header file for see.c */
+#ifndef SEE_H
+#define SEE_H
+U64 attackers_to(Bitboard *board, int square, U64 occupied);
+int see(Bitboard *board, move_t move);
+#endif
@@ -0,0 +1,59 @@
+/* time_manager.c
+ * Keeps track of the time used by the search.
+ *  -> Monotonic millisecond clock
+ *  -> Soft limit (don't start another iteration) and hard limit (stop searching right now)
+ *  -> The clock is only polled once every TIME_CHECK_NODES nodes, rather than at every node
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "time_manager.h"
+
+atomic_int stop_search = 0; /* Stop flag shared by all the search threads */
+int move_overhead = MOVE_OVERHEAD; /* Time (ms) kept aside from each move, set at runtime */
+
+long long search_start; /* When the search started (ms) */
+long long soft_limit; /* Don't start a new iteration after this time */
+long long hard_limit; /* Stop searching at this time */
+int time_limited = 0; /* Whether there is a time limit at all */
+atomic_int hard_limit_armed = 0; /* The hard limit is only enforced once there is a move to play (set by the main thread while the helpers are searching) */
+
+long long get_time_ms() {
+    /* Milliseconds on a monotonic clock (not affected by changes to the system time) */
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+void start_timer(int search_time) {
+    /* Start the clock for a search of search_time milliseconds (0 for no time limit) */
+    int budget = search_time - move_overhead; /* Time we can actually use */
+    if (budget < 1) budget = 1; /* Always search for a little bit */
+    search_start = get_time_ms();
+    hard_limit = search_start + budget;
+    soft_limit = search_start + (budget * SOFT_LIMIT_PERCENT) / 100;
+    time_limited = search_time > 0;
+    hard_limit_armed = 0; /* Not until the first iteration is done */
+    stop_search = 0; /* Start searching */
+}
+
+void arm_hard_limit() {
+    /* Start enforcing the hard limit (call once the first iteration has given a move) */
+    hard_limit_armed = 1;
+}
+
+void check_time() {
+    /* Stop the search if the hard limit has been reached */
+    if (time_limited && hard_limit_armed && get_time_ms() >= hard_limit)
+        stop_search = 1; /* Stop all the threads */
+}
+
+int soft_limit_reached() {
+    /* Whether there is not enough time left to start another iteration */
+    return time_limited && get_time_ms() >= soft_limit;
+}
+
+long long time_elapsed() {
+    /* Milliseconds since the search started */
+    return get_time_ms() - search_start;
+}
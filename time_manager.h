@@ -0,0 +1,16 @@
+/* Header file for time_manager.c */
+#ifndef TIMEMANAGER_H
+#define TIMEMANAGER_H
+#include <stdatomic.h>
+#define TIME_CHECK_NODES 1024 /* Check the clock once every this many nodes (must be a power of 2) */
+#define MOVE_OVERHEAD 10 /* Default time (ms) kept aside for making the move and GUI/communication lag */
+#define SOFT_LIMIT_PERCENT 50 /* Don't start a new iteration after this much of the time has been used */
+extern atomic_int stop_search; /* Set to stop all the search threads */
+extern int move_overhead;
+long long get_time_ms();
+void start_timer(int search_time);
+void arm_hard_limit();
+void check_time();
+int soft_limit_reached();
+long long time_elapsed();
+#endif
@@ -3,6 +3,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <limits.h>
 #include "bitboards.h"
 #include "bitboard_utils.h"
 #include "moves.h"
@@ -10,50 +14,180 @@
 #include "move_gen_utils.h"
 #include "lookup_tables.h"
 #include "legality_test.h"
+#include "search.h" /* Score range */
 #include "tp_table.h"
 #include "zobrist_hash.h"
 
-#define TP_SIZE 256 /* TP Table size in megabytes */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024) /* Transparent huge page size */
 
-int hash_move_used = 0;
+__thread int hash_move_used = 0; /* Tp table results used in place of a search, by the current thread */
 
-entry_t tp_table[(TP_SIZE  * 1000000) / sizeof(entry_t)]; /* Transposition Table Size is set above */
-int tp_size = (TP_SIZE  * 1000000) / sizeof(entry_t); /* Set TP Table Size */
+cluster_t *tp_table = 0; /* Transposition Table, allocated by init_tp_table */
+size_t tp_size = 0; /* Number of clusters in the TP Table */
+size_t tp_bytes = 0; /* Size of the TP Table in bytes (a multiple of the huge page size) */
+int tp_generation = 0; /* Current search, entries from older searches get replaced first */
+__thread long long tp_probes = 0; /* Table lookups by the current thread */
+__thread long long tp_hits = 0; /* Lookups that found the position */
 
-void init_tp_table() {
-    /* Resets all the values in the TP Table */
-    for (int i = 0; i < tp_size; i++) { /* Loop through all the entries in the tp_table */
-        entry_t entry = {0,0,0,0,0,0};
-        entry.depth = -1; /* Invalid entry */
-        tp_table[i] = entry; /* Set the entry */
+/* A note on empty entries.
+ * The table is never filled with invalid entries, it is just zeroed (mmap hands out zero pages, and clear_tp_table writes zeros).
+ * A zeroed entry has depth 0, which no stored entry has (depth 0 nodes go to quiescence), so it is always empty.
+*/
+
+void init_tp_table(int megabytes) {
+    /* Allocate the TP Table (freeing the old one), with a size in megabytes.
+     * The memory is mapped, not written, so the kernel only hands out (zeroed) pages when they are first used.
+     * This makes startup instant, and a short search never touches most of the table.
+     * Huge pages are requested, since the table is probed at random and would otherwise miss the TLB on almost every probe.
+    */
+    if (tp_table) munmap(tp_table, tp_bytes); /* Free the old table */
+    if (megabytes < 1) megabytes = 1;
+    tp_bytes = (size_t)megabytes * 1024 * 1024;
+    tp_bytes = (tp_bytes + HUGE_PAGE_SIZE - 1) & ~((size_t)HUGE_PAGE_SIZE - 1); /* Round up to whole huge pages */
+    // Map a little extra so that the table can start on a huge page boundary
+    char *mapping = mmap(NULL, tp_bytes + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) { /* Can't go on without a table */
+        fprintf(stderr, "Could not allocate a %d MB transposition table\n", megabytes);
+        exit(1);
     }
+    char *start = (char*)(((size_t)mapping + HUGE_PAGE_SIZE - 1) & ~((size_t)HUGE_PAGE_SIZE - 1)); /* First huge page boundary */
+    if (start > mapping) munmap(mapping, start - mapping); /* Give back the unaligned head */
+    munmap(start + tp_bytes, mapping + HUGE_PAGE_SIZE - start); /* And the tail */
+#ifdef MADV_HUGEPAGE
+    madvise(start, tp_bytes, MADV_HUGEPAGE); /* Ask for transparent huge pages (only a hint, so the result doesn't matter) */
+#endif
+    tp_table = (cluster_t*)start;
+    tp_size = tp_bytes / sizeof(cluster_t);
 }
 
-int to_replace(entry_t entry, int index) { 
-    /* Whether to replace the TP Table entry or not */
-    entry_t original = tp_table[index]; /* Get the original entry */
-    if (invalid_entry(original)) { /* If there is no entry in the original entry */
-        return 1; /* Replace it */
-    } else {
-        if (entry.depth >= original.depth) return 1; /* If the entry has a greater depth than the original */
-        else return 0;
+typedef struct clear_data_t {
+    /* Part of the TP Table to be cleared by one thread */
+    char *start;
+    size_t bytes;
+} clear_data_t;
+
+void *clear_slice(void *data_pointer) {
+    /* Zero one part of the TP Table */
+    clear_data_t *data = (clear_data_t*)data_pointer;
+    memset(data->start, 0, data->bytes);
+    return 0;
+}
+
+void clear_tp_table() {
+    /* Empty the TP Table (for a new game), splitting the work over the search threads since a large table takes a while to write */
+    int thread_count = (search_threads < MAX_THREADS) ? search_threads : MAX_THREADS;
+    pthread_t threads[MAX_THREADS];
+    clear_data_t slices[MAX_THREADS];
+    int index;
+    if (thread_count < 1) thread_count = 1;
+    size_t slice_bytes = (tp_bytes / thread_count) & ~(size_t)4095; /* Split on page boundaries */
+    for (index = 0; index < thread_count; index++) { /* Divide the table */
+        slices[index].start = (char*)tp_table + index * slice_bytes;
+        slices[index].bytes = (index == thread_count - 1) ? tp_bytes - index * slice_bytes : slice_bytes; /* The last thread takes what is left */
     }
+    for (index = 1; index < thread_count; index++) /* Start the helpers */
+        pthread_create(&threads[index], NULL, clear_slice, &slices[index]);
+    clear_slice(&slices[0]); /* The calling thread clears the first slice */
+    for (index = 1; index < thread_count; index++) /* Wait for the helpers */
+        pthread_join(threads[index], NULL);
+}
+
+void new_search_tp_table() {
+    /* Start a new generation, so that entries left over from earlier searches can be told apart (and replaced first) */
+    tp_generation = (tp_generation + 1) & GENERATION_MASK;
+}
+
+cluster_t *get_cluster(U64 key) {
+    /* Get the cluster a key belongs to.
+     * Multiply-shift maps the key onto [0, tp_size) with the high bits of a 128 bit product, which is much faster than a modulo.
+    */
+    return &tp_table[(size_t)(((unsigned __int128)key * tp_size) >> 64)];
+}
+
+void prefetch_entry(U64 key) {
+    /* Start loading the cluster of a key into the cache, so that it is (hopefully) there by the time the position is probed */
+    __builtin_prefetch(get_cluster(key));
 }
 
+// Lock-free access, one word at a time (plain moves on x86)
+#define load_word(word) atomic_load_explicit(&(word), memory_order_relaxed)
+#define store_word(word, value) atomic_store_explicit(&(word), (value), memory_order_relaxed)
+#define data_depth(data) (((data) >> 16) & 0xff)
+#define data_flags(data) ((data) >> 24)
 
-void add_entry(U64 key, int eval, int depth, int age, move_t best_move, node_t node_type) {
-    /* Add an entry to the tp_table */
-    int index = key % tp_size; /* Calculate the index of the entry in the transposition table */
-    entry_t entry = {key, eval, depth, age, best_move, node_type}; /* Set the entry object */
-    if (to_replace(entry, index)) { /* If it is ok to replace the entry */
-        tp_table[index] = entry; /* Set the entry in the table */
+int entry_age(uint32_t data) {
+    /* Number of searches since the entry was stored */
+    return (tp_generation - (data_flags(data) >> 2)) & GENERATION_MASK;
+}
+
+void add_entry(U64 key, int eval, int depth, move_t best_move, node_t node_type) {
+    /* Add an entry to the tp_table.
+     * If the position is already in the cluster, its entry is updated (unless it was searched deeper, and isn't exact).
+     * Otherwise the entry that is worth the least is replaced, by depth minus age, so that stale entries from earlier searches are evicted first.
+    */
+    cluster_t *cluster = get_cluster(key);
+    uint32_t check = (uint32_t)key;
+    packed_entry_t *replace = &cluster->entries[0]; /* Entry to replace */
+    int replace_worth = INT_MAX; /* Depth minus age of that entry */
+    for (int index = 0; index < CLUSTER_SIZE; index++) { /* Loop through the cluster */
+        packed_entry_t *entry = &cluster->entries[index];
+        uint32_t entry_move = load_word(entry->move), entry_data = load_word(entry->data);
+        if (data_depth(entry_data) && (load_word(entry->check) ^ entry_move ^ entry_data) == check) { /* Same position */
+            if (depth < (int)data_depth(entry_data) && node_type != node_pv && !entry_age(entry_data)) return; /* Keep the deeper search from this search */
+            if (!best_move) best_move = entry_move; /* Don't lose the old best move */
+            replace = entry;
+            break;
+        }
+        int worth = data_depth(entry_data) - 8 * entry_age(entry_data); /* Empty entries have depth 0 */
+        if (worth < replace_worth) { /* Worth less */
+            replace = entry;
+            replace_worth = worth;
+        }
     }
+    uint32_t data = (uint16_t)eval | ((uint32_t)depth << 16) | ((uint32_t)((tp_generation << 2) | node_type) << 24); /* Pack the entry */
+    store_word(replace->move, best_move);
+    store_word(replace->data, data);
+    store_word(replace->check, check ^ best_move ^ data);
 }
 
 entry_t get_entry(U64 key) {
     /* Get the entry from the tp table by key */
-    int index = key % tp_size; /* Calculate the entry index in the tp table */
-    entry_t entry = tp_table[index]; /* Get the entry from the tp_table */
-    if (entry.key != key) /* Entry does not match the key */ return EMPTY_ENTRY; /* Return invalid */
-    return entry; /* Otherwise, return the entry */
+    cluster_t *cluster = get_cluster(key);
+    uint32_t check = (uint32_t)key;
+    tp_probes++;
+    for (int index = 0; index < CLUSTER_SIZE; index++) { /* Look for the position in the cluster */
+        packed_entry_t *entry = &cluster->entries[index];
+        uint32_t move = load_word(entry->move), data = load_word(entry->data); /* Read the words once, they may change under us */
+        if (data_depth(data) && (load_word(entry->check) ^ move ^ data) == check) { /* Found it, and it wasn't torn */
+            tp_hits++;
+            return (entry_t){key, (int16_t)(data & 0xffff), data_depth(data), data_flags(data) >> 2, move, (node_t)(data_flags(data) & 3)};
+        }
+    }
+    return EMPTY_ENTRY; /* Return invalid */
+}
+
+int tp_hashfull() {
+    /* Permille of the table used by the current search, sampled from the first 1000 entries (like UCI's hashfull) */
+    int used = 0;
+    for (int index = 0; index < 1000; index++) { /* 200 clusters */
+        uint32_t data = load_word(tp_table[index / CLUSTER_SIZE].entries[index % CLUSTER_SIZE].data);
+        if (data_depth(data) && !entry_age(data)) used++; /* Stored in this search */
+    }
+    return used;
+}
+
+int score_to_tt(int score, int ply) {
+    /* Mate scores are counted from the root, but the same position can be reached at a different ply.
+     * Store them as the distance to mate from this node, so that they are still right when the entry is found through a transposition.
+    */
+    if (score > MATE_BOUND) return score + ply; /* Mating, the mate is ply moves closer to this node than to the root */
+    if (score < -MATE_BOUND) return score - ply; /* Getting mated */
+    return score;
+}
+
+int score_from_tt(int score, int ply) {
+    /* Undo score_to_tt, making a mate score relative to the root again */
+    if (score > MATE_BOUND) return score - ply;
+    if (score < -MATE_BOUND) return score + ply;
+    return score;
 }
@@ -4,6 +4,7 @@
 
 #ifndef TPTABLE_H
 #define TPTABLE_H 
+#include <stdatomic.h>
 
 // A short note on these node types, forgive me for being a little technical here.
 /* Due to the nature of the alpha-beta pruning algorithm, the nodes searched in the search tree may not result in the evaluation being exact.
@@ -12,23 +13,54 @@
  * All-Nodes - These are rather hard to understad, but due to the alpha-beta search, if none of the moves searched exceeds the alpha, the final evaluation will be an upper bound rather than the true evaluation, and will probably be pruned off the search tree.
 */
 
+#define TP_SIZE 256 /* Default TP Table size in megabytes */
+
 typedef enum node_t {node_pv, node_cut, node_all} node_t;
 
 typedef struct entry_t {
+    /* An entry as returned by get_entry */
     U64 key; /* The zobrist key */
     int eval; /* The evaluation */
     int depth; /* Depth at which this was searched */
-    int age; /* The number of moves at which this position was played */
+    int age; /* Generation (search number) in which this was stored */
     move_t best_move; /* The best move from this position */
     node_t node_type; /* Whether this has been pruned or not */
 } entry_t;
 
+typedef struct packed_entry_t {
+    /* An entry as stored in the table (12 bytes).
+     * All the search threads share the table without locks, reading and writing one 32 bit word at a time.
+     * check is the key XOR the two data words, so an entry torn by two threads writing at once no longer matches its key, and is ignored.
+    */
+    _Atomic uint32_t check; /* Low 32 bits of the zobrist key (the high bits pick the cluster), XOR move, XOR data */
+    _Atomic uint32_t move; /* Best move (moves don't fit in 16 bits, so they are stored whole) */
+    _Atomic uint32_t data; /* Evaluation in the low 16 bits, then depth (0 for an empty entry), then generation (6 bits) and node type (2 bits) */
+} packed_entry_t;
+
+#define CLUSTER_SIZE 5 /* Entries per cluster */
+typedef struct cluster_t {
+    /* Entries that share one 64 byte cache line, so a probe costs a single memory access */
+    packed_entry_t entries[CLUSTER_SIZE];
+    char padding[64 - CLUSTER_SIZE * sizeof(packed_entry_t)];
+} __attribute__((aligned(64))) cluster_t;
+
+#define GENERATION_MASK 63 /* Generations wrap around after 64 searches */
 #define invalid_entry(e) (e.depth == -1)
 #define EMPTY_ENTRY (entry_t){0,0,-1,0,0,0}
-void add_entry(U64 key, int eval, int depth, int age, move_t best_move, node_t node_type);
+void add_entry(U64 key, int eval, int depth, move_t best_move, node_t node_type);
 entry_t get_entry(U64 key);
-void init_tp_table();
-extern int tp_size;
-extern entry_t tp_table[]; /* Transposition Table */
-extern int hash_move_used;
+void prefetch_entry(U64 key);
+void init_tp_table(int megabytes);
+void clear_tp_table();
+void new_search_tp_table();
+int tp_hashfull();
+int score_to_tt(int score, int ply);
+int score_from_tt(int score, int ply);
+extern size_t tp_size;
+extern size_t tp_bytes;
+extern cluster_t *tp_table; /* Transposition Table */
+extern int tp_generation;
+extern __thread long long tp_probes;
+extern __thread long long tp_hits;
+extern __thread int hash_move_used;
 #endif
@@ -71,6 +71,7 @@ void update_key_prom(Bitboard *board, int piece, int from, int to, int type, int
     board->key ^= pst_hash[piece][from]; /* Remove the pawn */
     board->key ^= pst_hash[type][to]; /* Reappear as the new piece! */
     if (cap) board->key ^= pst_hash[cap_piece][to]; /* Remove the captured piece if any */
+    board->pawn_key ^= pst_hash[piece][from]; /* The pawn is gone (a piece captured on the last rank is never a pawn) */
 }
 
 void update_key_ep(Bitboard *board, int piece, int from, int to, int cap_square, int cap_piece) {
@@ -78,6 +79,7 @@ void update_key_ep(Bitboard *board, int piece, int from, int to, int cap_square,
     board->key ^= pst_hash[piece][from]; /* Remove the pawn */
     board->key ^= pst_hash[piece][to]; /* Put the pawn */
     board->key ^= pst_hash[cap_piece][cap_square]; /* Remove the captured pawn */
+    board->pawn_key ^= pst_hash[piece][from] ^ pst_hash[piece][to] ^ pst_hash[cap_piece][cap_square]; /* Only pawns involved */
 }
 
 void update_key_move(Bitboard *board, int piece, int from, int to, int cap, int cap_piece) {
@@ -85,5 +87,50 @@ void update_key_move(Bitboard *board, int piece, int from, int to, int cap, int
     board->key ^= pst_hash[piece][from]; /* Remove the piece */
     board->key ^= pst_hash[piece][to]; /* Put the piece */
     if (cap) board->key ^= pst_hash[cap_piece][to]; /* Remove the captured piece if any */
+    if (piece == pawn_w || piece == pawn_b) board->pawn_key ^= pst_hash[piece][from] ^ pst_hash[piece][to]; /* Pawn move */
+    if (cap && (cap_piece == pawn_w || cap_piece == pawn_b)) board->pawn_key ^= pst_hash[cap_piece][to]; /* Pawn captured */
 }
 
+
+U64 child_key(Bitboard *board, move_t move) {
+    /* Get the key of the position after a move, without making it (so that the tp table can be prefetched early).
+     * This has to do exactly what make_move does to the key.
+    */
+    U64 key = board->key ^ side_hash; /* Toggle side-to-move */
+    int side = board->side;
+    // Castling
+    if (move & MM_CAS) { /* Same as update_key_castle */
+        int cas_side = (move & MM_CSD) != 0;
+        if (side) { /* White */
+            key ^= pst_hash[king_w][4] ^ pst_hash[rook_w][cas_side ? 0 : 7] ^ pst_hash[king_w][cas_side ? 2 : 6] ^ pst_hash[rook_w][cas_side ? 3 : 5];
+            if (board->castling_rights & WK_CASTLE) key ^= cr_hash[0];
+            if (board->castling_rights & WQ_CASTLE) key ^= cr_hash[1];
+        } else { /* Black */
+            key ^= pst_hash[king_w][60] ^ pst_hash[rook_w][cas_side ? 56 : 63] ^ pst_hash[king_w][cas_side ? 58 : 62] ^ pst_hash[rook_w][cas_side ? 59 : 61];
+            if (board->castling_rights & BK_CASTLE) key ^= cr_hash[2];
+            if (board->castling_rights & BQ_CASTLE) key ^= cr_hash[3];
+        }
+        return key;
+    }
+    // Get move data
+    int from = move & MM_FROM;
+    int to = (move & MM_TO) >> MS_TO;
+    int piece = (move & MM_PIECE) >> MS_PIECE;
+    int cap_piece = (move & MM_EAT) >> MS_EAT;
+    int promoted = (move & MM_PPP) >> MS_PPP;
+    // Pieces
+    if (move & MM_PRO) key ^= pst_hash[piece][from] ^ pst_hash[side ? promoted : promoted + 6][to]; /* Pawn turns into the promoted piece */
+    else if (move & MM_EPC) key ^= pst_hash[piece][from] ^ pst_hash[piece][to] ^ pst_hash[side ? pawn_b : pawn_w][bitscan(ranks[side ? 32 : 24] & board->enpas)]; /* Pawn moves, and the pawn behind it is captured */
+    else key ^= pst_hash[piece][from] ^ pst_hash[piece][to]; /* Normal move */
+    if ((move & MM_CAP) && !(move & MM_EPC)) key ^= pst_hash[cap_piece][to]; /* Remove the captured piece */
+    // En-passant file
+    if (board->enpas) key ^= epf_hash[bitscan(board->enpas & 255)]; /* Remove the old one */
+    if (move & MM_DPP) key ^= epf_hash[to % 8]; /* Add the new one */
+    // Castling rights
+    U64 rights = board->castling_rights;
+    if (((piece == rook_w && from == 7) || piece == king_w) && (rights & WK_CASTLE)) key ^= cr_hash[0];
+    if (((piece == rook_w && from == 0) || piece == king_w) && (rights & WQ_CASTLE)) key ^= cr_hash[1];
+    if (((piece == rook_b && from == 63) || piece == king_b) && (rights & BK_CASTLE)) key ^= cr_hash[2];
+    if (((piece == rook_b && from == 56) || piece == king_b) && (rights & BQ_CASTLE)) key ^= cr_hash[3];
+    return key;
+}
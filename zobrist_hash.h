@@ -10,4 +10,5 @@ void update_key_castle(Bitboard *board, int side, int cas_side);
 void update_key_prom(Bitboard *board, int piece, int from, int to, int type, int cap, int cap_piece);
 void update_key_ep(Bitboard *board, int piece, int from, int to, int cap_square, int cap_piece);
 void update_key_move(Bitboard *board, int piece, int from, int to, int cap, int cap_piece);
+U64 child_key(Bitboard *board, move_t move);
 #endif